@@ -0,0 +1,98 @@
+#!/bin/sh
+#regression checks of the simulators built here, run by make check
+#prints one line per failed check and exits with failure if there was any
+failures=0
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+fail(){
+    echo "FAIL: $1"
+    failures=$((failures + 1))
+}
+
+#lines that aren't reads or writes, like the "#eof" end marker, aren't accesses
+expected=$(printf 'memread:3\nmemwrite:2\ncachehit:1\ncachemiss:3')
+[ "$(./first 64 assoc:2 lru 16 regress/eof.txt)" = "$expected" ] || fail "first on a trace ending in #eof"
+
+#binary input arriving in pieces, the first shorter than the header
+./generate zipf 20000 "$work/zipf.bin"
+expected=$(./first 32768 assoc:8 lru 64 "$work/zipf.bin")
+actual=$( (head -c 5 "$work/zipf.bin"; sleep 0.3; tail -c +6 "$work/zipf.bin") | ./first 32768 assoc:8 lru 64 -)
+[ "$actual" = "$expected" ] || fail "binary trace split across pipe reads"
+
+#a resumed run prints what an uninterrupted one does, and refuses a different trace
+./generate random 20000 "$work/random.bin"
+hierarchy="1024 assoc:8 lru 64 32768 assoc:32 lru"
+expected=$(./second --write-back $hierarchy "$work/zipf.bin")
+./second --write-back --records 7777 --checkpoint "$work/checkpoint" $hierarchy "$work/zipf.bin" > /dev/null
+actual=$(./second --write-back --resume "$work/checkpoint" $hierarchy "$work/zipf.bin")
+[ "$actual" = "$expected" ] || fail "resume from a checkpoint"
+./second --write-back --checkpoint "$work/missing/checkpoint" $hierarchy "$work/zipf.bin" > /dev/null 2>&1 && fail "exit status when a checkpoint can't be written"
+./second --write-back --resume "$work/checkpoint" $hierarchy "$work/random.bin" > /dev/null 2>&1 && fail "resume on a different trace"
+
+#every inclusion mode at one to three levels and every write policy against the naive model in
+#hiermodel.py, then first against a one level hierarchy
+./generate --text --footprint 16384 random 20000 "$work/random.txt"
+levels="level 1024 assoc:2 lru
+level 4096 assoc:4 fifo
+level 16384 assoc:8 lru"
+for inclusion in inclusive exclusive nine; do
+    for numLevels in 1 2 3; do
+        for write in through back; do
+            for allocate in yes no; do
+                config="$work/$inclusion-$numLevels-$write-$allocate"
+                printf 'block 32\ninclusion %s\nwrite %s\nallocate %s\n' $inclusion $write $allocate > "$config"
+                echo "$levels" | head -n $numLevels >> "$config"
+                if command -v python3 > /dev/null; then
+                    expected=$(python3 hiermodel.py "$config" "$work/random.txt")
+                    [ "$(./second --config "$config" "$work/random.txt")" = "$expected" ] || fail "second against the model, $inclusion $numLevels levels, write $write, allocate $allocate"
+                fi
+            done
+        done
+    done
+done
+[ -n "$(command -v python3)" ] || echo "python3 not found, skipped the hierarchy model checks"
+for options in "" "--write-back" "--no-write-allocate" "--write-back --no-write-allocate"; do
+    expected=$(./second $options --config "$work/nine-1-through-yes" "$work/random.txt" | sed 's/^l1//')
+    [ "$(./first $options 1024 assoc:2 lru 32 "$work/random.txt")" = "$expected" ] || fail "first against a one level hierarchy with '$options'"
+    [ "$(./first $options --threads 3 1024 assoc:2 lru 32 "$work/random.txt")" = "$expected" ] || fail "first on three threads with '$options'"
+done
+
+#a sampled run estimates every result line an exact run prints
+hierarchy="1024 assoc:8 lru 64 32768 assoc:32 lru"
+for options in "--write-back --prefetch stride:2:1" "--no-write-allocate"; do
+    exact=$(./second $options $hierarchy "$work/zipf.bin" | cut -d: -f1)
+    sampled=$(./second $options --sample-intervals 2000:200:200 $hierarchy "$work/zipf.bin" | cut -d: -f1 | head -n $(echo "$exact" | wc -l))
+    [ "$sampled" = "$exact" ] || fail "second's sampled result lines with '$options'"
+    exact=$(./first $options 1024 assoc:2 lru 64 "$work/zipf.bin" | cut -d: -f1)
+    sampled=$(./first $options --sample-intervals 2000:200:200 1024 assoc:2 lru 64 "$work/zipf.bin" | cut -d: -f1 | head -n $(echo "$exact" | wc -l))
+    [ "$sampled" = "$exact" ] || fail "first's sampled result lines with '$options'"
+done
+
+#skipping through the index of a mapped trace lands where walking a piped one's chunks does
+./generate random 300000 "$work/long.bin"
+expected=$(./first --sample-intervals 100000:1000:1000 1024 assoc:2 lru 64 - < "$work/long.bin")
+[ "$(./first --sample-intervals 100000:1000:1000 1024 assoc:2 lru 64 "$work/long.bin")" = "$expected" ] || fail "skipping a binary trace through its index"
+
+#a binary trace of another version fails instead of being read as text
+{ printf 'CTRB\001\000'; tail -c +7 "$work/zipf.bin"; } > "$work/version1.bin"
+./first 32768 assoc:8 lru 64 "$work/version1.bin" > /dev/null 2>&1 && fail "first on a binary trace of another version"
+./second $hierarchy - < "$work/version1.bin" > /dev/null 2>&1 && fail "second on a piped binary trace of another version"
+
+#a streamed trace that can't be read fails instead of printing the results of what came before
+./first 32768 assoc:8 lru 64 - < "$work" > /dev/null 2>&1 && fail "first on an unreadable piped trace"
+./second $hierarchy - < "$work" > /dev/null 2>&1 && fail "second on an unreadable piped trace"
+
+#a prefetched block an exclusive L1 evicts moves down still prefetched, used from the L2 it is useful
+printf 'inclusion exclusive\nlevel 128 assoc:1 lru\nlevel 1024 assoc:2 lru\n' > "$work/prefetch.cfg"
+printf 'R 0x0\nR 0x80\nR 0x40\n' > "$work/prefetch.txt"
+[ "$(./second --prefetch nextline --config "$work/prefetch.cfg" "$work/prefetch.txt" | grep -E 'useful|useless' | tr '\n' ' ')" = "prefetchuseful:1 prefetchuseless:0 " ] || fail "second's prefetch counters in an exclusive hierarchy"
+
+#a cache that can't be allocated is reported instead of crashing
+(ulimit -v 100000; ./first 1073741824 assoc:1 lru 64 - < /dev/null > /dev/null 2>&1) && fail "first with a cache that can't be allocated"
+(ulimit -v 100000; ./second 1024 assoc:1 lru 64 1073741824 assoc:1 lru - < /dev/null > /dev/null 2>&1) && fail "second with a cache that can't be allocated"
+
+if [ $failures -gt 0 ]; then
+    exit 1
+fi
+echo "all checks passed"
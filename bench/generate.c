@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "trace.h"
+#include "tracebin.h"
+
+//bytes the generated addresses range over unless --footprint says otherwise
+#define DEFAULT_FOOTPRINT (64L << 20)
+#define BASE_ADDRESS 0x10000000UL
+#define STRIDE 256
+#define NODE_SIZE 64
+#define ZIPF_EXPONENT 0.99
+
+enum Pattern{
+    PATTERN_SEQUENTIAL,
+    PATTERN_STRIDED,
+    PATTERN_RANDOM,
+    PATTERN_ZIPF,
+    PATTERN_CHASE,
+    NUM_PATTERNS
+};
+
+static const char *patternNames[NUM_PATTERNS] = {
+    [PATTERN_SEQUENTIAL] = "sequential",
+    [PATTERN_STRIDED] = "strided",
+    [PATTERN_RANDOM] = "random",
+    [PATTERN_ZIPF] = "zipf",
+    [PATTERN_CHASE] = "chase"
+};
+
+//xorshift64*, every pattern is a pure function of its seed
+static unsigned long nextRandom(unsigned long *state){
+    unsigned long x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DUL;
+}
+
+//uniform in [0, 1)
+static double nextUniform(unsigned long *state){
+    return (nextRandom(state) >> 11) * (1.0 / (1UL << 53));
+}
+
+//one in four records is a write, except along a pointer chase which only loads
+static char nextAction(unsigned long *state){
+    return (nextRandom(state) & 3) == 0 ? 'W' : 'R';
+}
+
+//cumulative probabilities of blocks 0 .. n - 1 with block k weighted 1 / (k + 1)^ZIPF_EXPONENT
+static double *zipfTable(long n){
+    double *table = malloc(n * sizeof(double));
+    double sum = 0;
+    for(long k = 0; k < n; k ++){
+        sum += 1.0 / pow(k + 1, ZIPF_EXPONENT);
+        table[k] = sum;
+    }
+    for(long k = 0; k < n; k ++){
+        table[k] /= sum;
+    }
+    return table;
+}
+
+static long zipfBlock(double *table, long n, unsigned long *state){
+    double u = nextUniform(state);
+    long low = 0;
+    long high = n - 1;
+    while(low < high){
+        long middle = (low + high) / 2;
+        if(table[middle] < u){
+            low = middle + 1;
+        }
+        else{
+            high = middle;
+        }
+    }
+    return low;
+}
+
+//a single cycle through every node (Sattolo's shuffle), so the chase visits each node once
+//per lap in an order the hardware can't predict
+static long *chaseCycle(long n, unsigned long *state){
+    long *next = malloc(n * sizeof(long));
+    for(long i = 0; i < n; i ++){
+        next[i] = i;
+    }
+    for(long i = n - 1; i > 0; i --){
+        long j = nextRandom(state) % i;
+        long swap = next[i];
+        next[i] = next[j];
+        next[j] = swap;
+    }
+    return next;
+}
+
+//generate [--text] [--seed N] [--footprint bytes] <pattern> <records> <output>
+//pattern is sequential, strided, random, zipf or chase, output is a binary trace unless --text
+int main(int argc, char* argv[argc + 1]){
+    bool text = false;
+    unsigned long seed = 1;
+    long footprint = DEFAULT_FOOTPRINT;
+    int option = 1;
+    while(option < argc && argv[option][0] == '-' && argv[option][1] != '\0'){
+        if(strcmp(argv[option], "--text") == 0){
+            text = true;
+        }
+        else if(strcmp(argv[option], "--seed") == 0 && option + 1 < argc){
+            seed = strtoul(argv[++ option], NULL, 10);
+        }
+        else if(strcmp(argv[option], "--footprint") == 0 && option + 1 < argc){
+            footprint = atol(argv[++ option]);
+        }
+        else{
+            fprintf(stderr, "unknown option %s\n", argv[option]);
+            return EXIT_FAILURE;
+        }
+        option ++;
+    }
+    argv += option - 1;
+    argc -= option - 1;
+    if(argc != 4 || footprint < NODE_SIZE){
+        fprintf(stderr, "usage: generate [--text] [--seed N] [--footprint bytes] <sequential|strided|random|zipf|chase> <records> <output>\n");
+        return EXIT_FAILURE;
+    }
+    enum Pattern pattern = 0;
+    while(pattern < NUM_PATTERNS && strcmp(argv[1], patternNames[pattern]) != 0){
+        pattern ++;
+    }
+    if(pattern == NUM_PATTERNS){
+        fprintf(stderr, "unknown pattern %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    long records = atol(argv[2]);
+    //the state must never be zero
+    unsigned long state = seed * 0x9E3779B97F4A7C15UL + 1;
+    long nodes = footprint / NODE_SIZE;
+    double *zipf = NULL;
+    long *chase = NULL;
+    if(pattern == PATTERN_ZIPF){
+        zipf = zipfTable(nodes);
+    }
+    else if(pattern == PATTERN_CHASE){
+        chase = chaseCycle(nodes, &state);
+    }
+    FILE *textFile = NULL;
+    struct TraceWriter *writer = NULL;
+    if(text){
+        textFile = strcmp(argv[3], "-") == 0 ? stdout : fopen(argv[3], "w");
+    }
+    else{
+        writer = createTraceWriter(argv[3]);
+    }
+    if(textFile == NULL && writer == NULL){
+        printf("error");
+        return EXIT_FAILURE;
+    }
+    struct TraceRecord batch[TRACE_BATCH_SIZE];
+    long node = 0;
+    for(long done = 0; done < records; ){
+        int count = records - done < TRACE_BATCH_SIZE ? records - done : TRACE_BATCH_SIZE;
+        for(int i = 0; i < count; i ++){
+            long n = done + i;
+            unsigned long offset;
+            char memAction = nextAction(&state);
+            switch(pattern){
+                case PATTERN_SEQUENTIAL:
+                    offset = n * 8 % footprint;
+                    break;
+                case PATTERN_STRIDED:
+                    //shift each lap by a word so successive laps touch new bytes of each block
+                    offset = (n * STRIDE + n * STRIDE / footprint * 8) % footprint;
+                    break;
+                case PATTERN_RANDOM:
+                    offset = nextRandom(&state) % (footprint / 8) * 8;
+                    break;
+                case PATTERN_ZIPF:
+                    offset = zipfBlock(zipf, nodes, &state) * NODE_SIZE;
+                    break;
+                default:
+                    node = chase[node];
+                    offset = node * NODE_SIZE;
+                    memAction = 'R';
+                    break;
+            }
+            batch[i].memAction = memAction;
+            batch[i].address = BASE_ADDRESS + offset;
+        }
+        if(text){
+            for(int i = 0; i < count; i ++){
+                fprintf(textFile, "%c 0x%lx\n", batch[i].memAction, batch[i].address);
+            }
+        }
+        else{
+            writeTraceRecords(writer, batch, count);
+        }
+        done += count;
+    }
+    bool ok = text ? (textFile == stdout ? fflush(stdout) == 0 : fclose(textFile) == 0) : closeTraceWriter(writer);
+    free(zipf);
+    free(chase);
+    if(!ok){
+        printf("error");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+#A deliberately naive model of second's hierarchy engine, for check.sh to compare against.
+#Each set is an ordered dict of block -> dirty, oldest first, so lru and fifo only differ in
+#whether a hit moves the block to the end. It takes the same hierarchy files as
+#second --config (lru and fifo levels, no prefetch line) and prints the same result lines.
+#usage: hiermodel.py <hierarchy file> <text trace>
+import sys
+from collections import OrderedDict
+
+
+class Level:
+    def __init__(self, size, associativity, policy, blockSize):
+        self.numSets = size // associativity // blockSize
+        self.associativity = associativity
+        self.lru = policy == "lru"
+        self.sets = [OrderedDict() for _ in range(self.numSets)]
+        self.hits = 0
+        self.misses = 0
+        self.dirtyEvictions = 0
+
+    def lookup(self, block):
+        return self.sets[block % self.numSets]
+
+    def has(self, block):
+        return block in self.lookup(block)
+
+    def touch(self, block):
+        if self.lru:
+            self.lookup(block).move_to_end(block)
+
+    def setDirty(self, block):
+        self.lookup(block)[block] = True
+
+    #returns whether the removed block was dirty
+    def invalidate(self, block):
+        return self.lookup(block).pop(block, False)
+
+    #returns the victim and whether it was dirty, the victim is None when a way was free
+    def fill(self, block, dirty):
+        blocks = self.lookup(block)
+        victim, victimDirty = None, False
+        if len(blocks) >= self.associativity:
+            victim, victimDirty = blocks.popitem(last=False)
+        blocks[block] = dirty
+        return victim, victimDirty
+
+
+class Hierarchy:
+    def __init__(self, configs, inclusion, blockSize, writeBack, writeAllocate):
+        self.levels = [Level(size, associativity, policy, blockSize) for size, associativity, policy in configs]
+        self.inclusion = inclusion
+        self.blockSize = blockSize
+        self.writeBack = writeBack
+        self.writeAllocate = writeAllocate
+        self.memReads = 0
+        self.memWrites = 0
+
+    #a write back lands in the first level from level down holding the block, or in memory
+    def writeBackBlock(self, level, block):
+        for lower in self.levels[level:]:
+            if lower.has(block):
+                lower.setDirty(block)
+                return
+        self.memWrites += 1
+
+    def fillLevel(self, level, block, dirty):
+        while level < len(self.levels):
+            victim, victimDirty = self.levels[level].fill(block, dirty)
+            if victim is None:
+                return
+            if victimDirty:
+                self.levels[level].dirtyEvictions += 1
+            if self.inclusion == "inclusive":
+                #back invalidate the levels above, their dirty copies are written back too
+                dirtyAbove = False
+                for upper in self.levels[:level]:
+                    if upper.has(victim) and upper.invalidate(victim):
+                        upper.dirtyEvictions += 1
+                        dirtyAbove = True
+                if dirtyAbove or victimDirty:
+                    self.writeBackBlock(level + 1, victim)
+                return
+            if self.inclusion == "nine":
+                if victimDirty:
+                    self.writeBackBlock(level + 1, victim)
+                return
+            #exclusive, the victim moves down a level
+            block, dirty = victim, victimDirty
+            level += 1
+        if dirty:
+            self.memWrites += 1
+
+    def access(self, action, address):
+        block = address // self.blockSize
+        write = action == "W"
+        if write and not self.writeBack:
+            self.memWrites += 1
+        level = 0
+        while level < len(self.levels) and not self.levels[level].has(block):
+            self.levels[level].misses += 1
+            level += 1
+        allocate = not write or self.writeAllocate
+        dirty = write and self.writeBack
+        if level == 0:
+            self.levels[0].hits += 1
+            self.levels[0].touch(block)
+            if dirty:
+                self.levels[0].setDirty(block)
+            return
+        if level < len(self.levels):
+            self.levels[level].hits += 1
+            if not allocate:
+                self.levels[level].touch(block)
+                if dirty:
+                    self.levels[level].setDirty(block)
+                return
+            if self.inclusion == "exclusive":
+                dirty = self.levels[level].invalidate(block) or dirty
+            else:
+                self.levels[level].touch(block)
+        elif not allocate:
+            if self.writeBack:
+                self.memWrites += 1
+            return
+        else:
+            self.memReads += 1
+        if self.inclusion == "exclusive":
+            self.fillLevel(0, block, dirty)
+        else:
+            for upper in range(level - 1, -1, -1):
+                self.fillLevel(upper, block, upper == 0 and dirty)
+
+    def printResults(self):
+        print("memread:%d\nmemwrite:%d" % (self.memReads, self.memWrites))
+        for i, level in enumerate(self.levels):
+            print("l%dcachehit:%d\nl%dcachemiss:%d" % (i + 1, level.hits, i + 1, level.misses))
+            if self.writeBack or not self.writeAllocate:
+                print("l%ddirtyevictions:%d\nl%dwritebackbytes:%d" % (i + 1, level.dirtyEvictions, i + 1, level.dirtyEvictions * self.blockSize))
+
+
+def readHierarchyFile(path):
+    configs = []
+    inclusion, blockSize, writeBack, writeAllocate = "exclusive", 64, False, True
+    for line in open(path):
+        fields = line.split()
+        if not fields or fields[0].startswith("#"):
+            continue
+        if fields[0] == "block":
+            blockSize = int(fields[1])
+        elif fields[0] == "inclusion":
+            inclusion = fields[1]
+        elif fields[0] == "write":
+            writeBack = fields[1] == "back"
+        elif fields[0] == "allocate":
+            writeAllocate = fields[1] == "yes"
+        elif fields[0] == "level":
+            configs.append((int(fields[1]), int(fields[2][6:]), fields[3]))
+    return Hierarchy(configs, inclusion, blockSize, writeBack, writeAllocate)
+
+
+def main():
+    hierarchy = readHierarchyFile(sys.argv[1])
+    for line in open(sys.argv[2]):
+        fields = line.split()
+        if len(fields) >= 2 and fields[0] in ("R", "W"):
+            hierarchy.access(fields[0], int(fields[1], 16))
+    hierarchy.printResults()
+
+
+if __name__ == "__main__":
+    main()
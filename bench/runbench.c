@@ -0,0 +1,142 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "trace.h"
+
+#define MAX_ARGUMENTS 16
+#define DEFAULT_REPEATS 3
+
+//representative geometries, the trace path is appended as the last argument
+struct Benchmark{
+    const char *program;
+    const char *name;
+    const char *arguments[MAX_ARGUMENTS];
+};
+
+static const struct Benchmark benchmarks[] = {
+    {"first", "direct-32k", {"32768", "assoc:1", "fifo", "64"}},
+    {"first", "lru-32k-8way", {"32768", "assoc:8", "lru", "64"}},
+    {"first", "plru-256k-16way", {"262144", "assoc:16", "plru", "64"}},
+    {"first", "srrip-1m-16way", {"1048576", "assoc:16", "srrip", "64"}},
+    {"first", "lru-64k-128way", {"65536", "assoc:128", "lru", "64"}},
+    {"first", "lru-32k-8way-writeback", {"--write-back", "32768", "assoc:8", "lru", "64"}},
+    {"second", "lru-32k-8way-lru-1m-16way", {"32768", "assoc:8", "lru", "64", "1048576", "assoc:16", "lru"}},
+    {"second", "fifo-16k-4way-plru-256k-8way", {"16384", "assoc:4", "fifo", "64", "262144", "assoc:8", "plru"}},
+};
+
+static double now(void){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+//records in the trace, counted by reading it through once
+static unsigned long countRecords(const char *path){
+    struct TraceReader *reader = openTrace(path);
+    if(reader == NULL){
+        return 0;
+    }
+    if(reader->binary){
+        unsigned long count = reader->header.recordCount;
+        closeTrace(reader);
+        return count;
+    }
+    struct TraceRecord records[TRACE_BATCH_SIZE];
+    while(readTraceBatch(reader, records, TRACE_BATCH_SIZE) > 0){
+    }
+    unsigned long count = reader->records;
+    closeTrace(reader);
+    return count;
+}
+
+//run the program once with its output discarded, returns false if it didn't exit cleanly
+static bool runOnce(const char *path, const struct Benchmark *benchmark, const char *trace, double *seconds, long *maxRss){
+    const char *argv[MAX_ARGUMENTS + 2];
+    int argc = 0;
+    argv[argc ++] = path;
+    for(int i = 0; benchmark->arguments[i] != NULL; i ++){
+        argv[argc ++] = benchmark->arguments[i];
+    }
+    argv[argc ++] = trace;
+    argv[argc] = NULL;
+    double start = now();
+    pid_t child = fork();
+    if(child == 0){
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        execv(path, (char **)argv);
+        _exit(127);
+    }
+    int status;
+    struct rusage usage;
+    if(child < 0 || wait4(child, &status, 0, &usage) != child){
+        return false;
+    }
+    *seconds = now() - start;
+    *maxRss = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+//runbench [--repeat N] [--bin dir] <trace>...
+//runs every benchmark on every trace and prints one line per pair, the best time of N runs
+//and the peak resident set size of the largest
+int main(int argc, char* argv[argc + 1]){
+    int repeats = DEFAULT_REPEATS;
+    const char *binaryDirectory = ".";
+    int option = 1;
+    while(option < argc && argv[option][0] == '-' && argv[option][1] != '\0'){
+        if(strcmp(argv[option], "--repeat") == 0 && option + 1 < argc){
+            repeats = atoi(argv[++ option]);
+        }
+        else if(strcmp(argv[option], "--bin") == 0 && option + 1 < argc){
+            binaryDirectory = argv[++ option];
+        }
+        else{
+            fprintf(stderr, "unknown option %s\n", argv[option]);
+            return EXIT_FAILURE;
+        }
+        option ++;
+    }
+    if(option == argc || repeats < 1){
+        fprintf(stderr, "usage: runbench [--repeat N] [--bin dir] <trace>...\n");
+        return EXIT_FAILURE;
+    }
+    bool ok = true;
+    for(int t = option; t < argc; t ++){
+        const char *trace = argv[t];
+        unsigned long records = countRecords(trace);
+        const char *traceName = strrchr(trace, '/') != NULL ? strrchr(trace, '/') + 1 : trace;
+        for(size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b ++){
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/%s", binaryDirectory, benchmarks[b].program);
+            double best = 0;
+            long peak = 0;
+            bool ran = true;
+            for(int r = 0; r < repeats && ran; r ++){
+                double seconds = 0;
+                long maxRss = 0;
+                ran = runOnce(path, &benchmarks[b], trace, &seconds, &maxRss);
+                if(r == 0 || seconds < best){
+                    best = seconds;
+                }
+                if(maxRss > peak){
+                    peak = maxRss;
+                }
+            }
+            if(!ran){
+                fprintf(stderr, "%s %s failed on %s\n", benchmarks[b].program, benchmarks[b].name, trace);
+                ok = false;
+                continue;
+            }
+            printf("program:%s config:%s trace:%s records:%lu seconds:%.4f recordspersec:%.0f nsperrecord:%.2f maxrsskb:%ld\n", benchmarks[b].program, benchmarks[b].name, traceName, records, best, best > 0 ? records / best : 0, records > 0 ? best * 1e9 / records : 0, peak);
+            fflush(stdout);
+        }
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+//sets narrower than this are quicker to walk one way at a time
+#define SIMD_MIN_WAYS 8
+
+//same as truncating log2l(), without the long double libm call
+static int floorLog2(unsigned long value){
+    return 63 - __builtin_clzl(value);
+}
+
+static unsigned long matchTagsScalar(const unsigned long *tags, unsigned long tag, int ways){
+    unsigned long mask = 0;
+    for(int i = 0; i < ways; i ++){
+        mask |= (unsigned long)(tags[i] == tag) << i;
+    }
+    return mask;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("sse4.2")))
+static unsigned long matchTagsSSE42(const unsigned long *tags, unsigned long tag, int ways){
+    __m128i key = _mm_set1_epi64x((long long)tag);
+    unsigned long mask = 0;
+    int i = 0;
+    for(; i + 2 <= ways; i += 2){
+        __m128i equal = _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i *)&tags[i]), key);
+        mask |= (unsigned long)_mm_movemask_pd(_mm_castsi128_pd(equal)) << i;
+    }
+    return mask | (matchTagsScalar(&tags[i], tag, ways - i) << i);
+}
+
+__attribute__((target("avx2")))
+static unsigned long matchTagsAVX2(const unsigned long *tags, unsigned long tag, int ways){
+    __m256i key = _mm256_set1_epi64x((long long)tag);
+    unsigned long mask = 0;
+    int i = 0;
+    for(; i + 4 <= ways; i += 4){
+        __m256i equal = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)&tags[i]), key);
+        mask |= (unsigned long)_mm256_movemask_pd(_mm256_castsi256_pd(equal)) << i;
+    }
+    return mask | (matchTagsScalar(&tags[i], tag, ways - i) << i);
+}
+
+#endif
+
+enum SetScan bestSetScan(void){
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        return SCAN_AVX2;
+    }
+    if(__builtin_cpu_supports("sse4.2")){
+        return SCAN_SSE42;
+    }
+#endif
+    return SCAN_SCALAR;
+}
+
+const char *setScanName(enum SetScan scan){
+    static const char *names[] = {[SCAN_SCALAR] = "scalar", [SCAN_SSE42] = "sse4.2", [SCAN_AVX2] = "avx2"};
+    return names[scan];
+}
+
+void useSetScan(struct Cache *cache, enum SetScan scan){
+    cache->matchTags = matchTagsScalar;
+#ifdef HAVE_X86_SIMD
+    if(scan == SCAN_AVX2){
+        cache->matchTags = matchTagsAVX2;
+    }
+    else if(scan == SCAN_SSE42){
+        cache->matchTags = matchTagsSSE42;
+    }
+#else
+    (void)scan;
+#endif
+}
+
+//valid bits of ways consecutive slots starting at base (ways <= 64), which may straddle two words
+static unsigned long slotBits(struct Cache *cache, unsigned long base, int ways){
+    unsigned long shift = base & 63;
+    unsigned long bits = cache->validBits[base >> 6] >> shift;
+    if(shift + ways > 64){
+        bits |= cache->validBits[(base >> 6) + 1] << (64 - shift);
+    }
+    return ways == 64 ? bits : bits & ((1UL << ways) - 1);
+}
+
+struct Cache *newCache(int numSets, int associativity, int blockSize, enum ReplacementPolicy policy){
+    size_t numSlots = (size_t)numSets * associativity;
+    size_t header = lineAlign(sizeof(struct Cache));
+    size_t tagBytes = lineAlign(numSlots * sizeof(unsigned long));
+    size_t validBytes = lineAlign((numSlots + 63) / 64 * sizeof(unsigned long));
+    size_t countBytes = associativity > 64 ? lineAlign(numSets * sizeof(int)) : 0;
+    size_t replacementSize = replacementBytes(numSets, associativity, policy);
+    char *arena = aligned_alloc(64, header + tagBytes + 2 * validBytes + countBytes + replacementSize);
+    if(arena == NULL){
+        return NULL;
+    }
+    struct Cache *cache = (struct Cache *)arena;
+    cache->numSets = numSets;
+    cache->associativity = associativity;
+    cache->blockSize = blockSize;
+    cache->offsetBits = floorLog2(blockSize);
+    cache->indexBits = floorLog2(numSets);
+    cache->indexMask = numSets - 1;
+    cache->tags = (unsigned long *)(arena + header);
+    cache->validBits = (unsigned long *)(arena + header + tagBytes);
+    cache->dirtyBits = (unsigned long *)(arena + header + tagBytes + validBytes);
+    cache->validCounts = countBytes > 0 ? (int *)(arena + header + tagBytes + 2 * validBytes) : NULL;
+    memset(cache->tags, 0, tagBytes + 2 * validBytes + countBytes);
+    initReplacement(&cache->replacement, numSets, associativity, policy, arena + header + tagBytes + 2 * validBytes + countBytes);
+    cache->stateBytes = tagBytes + 2 * validBytes + countBytes + replacementSize;
+    cache->blockIndex = associativity > 64 && numSets == 1 ? newHashMap(associativity) : NULL;
+    useSetScan(cache, associativity >= SIMD_MIN_WAYS ? bestSetScan() : SCAN_SCALAR);
+    return cache;
+}
+
+void freeCache(struct Cache *cache){
+    if(cache->blockIndex != NULL){
+        freeHashMap(cache->blockIndex);
+    }
+    free(cache);
+}
+
+//the replacement state only holds way numbers, never pointers, so the whole state can be
+//copied out and back into a cache of the same geometry and policy
+bool writeCacheState(struct Cache *cache, FILE *file){
+    return fwrite(cache->tags, 1, cache->stateBytes, file) == cache->stateBytes;
+}
+
+bool readCacheState(struct Cache *cache, FILE *file){
+    if(fread(cache->tags, 1, cache->stateBytes, file) != cache->stateBytes){
+        return false;
+    }
+    if(cache->blockIndex != NULL){
+        freeHashMap(cache->blockIndex);
+        cache->blockIndex = newHashMap(cache->associativity);
+        for(int way = 0; way < cache->associativity; way ++){
+            if(isValid(cache, way)){
+                hashMapPut(cache->blockIndex, cache->tags[way], way);
+            }
+        }
+    }
+    return true;
+}
+
+unsigned long computeIndex(unsigned long address, int numSets, int blockSize){
+    unsigned long b = floorLog2(blockSize);
+    return ((address >> b) & (numSets - 1));
+}
+
+unsigned long computeTag(unsigned long address, int numSets, int blockSize){
+    unsigned long b = floorLog2(blockSize);
+    unsigned long n = floorLog2(numSets);
+    return (address >> (b + n));
+}
+
+//rebuild the (block aligned) address a tag/index pair was computed from
+unsigned long blockAddress(struct Cache *cache, unsigned long index, unsigned long tag){
+    return (tag << (cache->offsetBits + cache->indexBits)) | (index << cache->offsetBits);
+}
+
+//returns the way holding a valid block with this tag, or -1 on a miss
+int findBlock(struct Cache *cache, unsigned long index, unsigned long tag){
+    if(cache->blockIndex != NULL){
+        unsigned long way;
+        return hashMapGet(cache->blockIndex, tag, &way) ? (int)way : -1;
+    }
+    unsigned long base = index * cache->associativity;
+    unsigned long *tags = &cache->tags[base];
+    if(cache->associativity <= 64){
+        //every tag compared at once, masked down to the valid ways
+        unsigned long hits = cache->matchTags(tags, tag, cache->associativity) & slotBits(cache, base, cache->associativity);
+        return hits != 0 ? __builtin_ctzl(hits) : -1;
+    }
+    for(int i = 0; i < cache->associativity; i ++){
+        if(tags[i] == tag && isValid(cache, base + i)){
+            return i;
+        }
+    }
+    return -1;
+}
+
+//first invalid way of the set at base, or -1 if it is full
+static int firstInvalid(struct Cache *cache, unsigned long index, unsigned long base){
+    int associativity = cache->associativity;
+    if(associativity <= 64){
+        unsigned long invalid = ~slotBits(cache, base, associativity) & fullSet(associativity);
+        return invalid != 0 ? __builtin_ctzl(invalid) : -1;
+    }
+    if(cache->validCounts[index] == associativity){
+        return -1;
+    }
+    for(int i = 0; i < associativity; i += 64){
+        int ways = associativity - i < 64 ? associativity - i : 64;
+        unsigned long invalid = ~slotBits(cache, base + i, ways) & fullSet(ways);
+        if(invalid != 0){
+            return i + __builtin_ctzl(invalid);
+        }
+    }
+    return -1;
+}
+
+//put a block (dirty or clean) in the first invalid way, or over the policy's victim if the set is full
+//returns 0, or EVICTED (plus EVICTED_DIRTY) and the address of the old block if a valid block had to go
+int fillBlock(struct Cache *cache, unsigned long index, unsigned long tag, bool dirty, unsigned long *evictedAddress){
+    unsigned long base = index * cache->associativity;
+    int way = firstInvalid(cache, index, base);
+    int evicted = 0;
+    if(way < 0){
+        //all blocks are valid so it is a collision
+        way = victimWay(&cache->replacement, index, 0, cache->replacement.policy);
+        evicted = isDirty(cache, base + way) ? EVICTED | EVICTED_DIRTY : EVICTED;
+        if(evictedAddress != NULL){
+            *evictedAddress = blockAddress(cache, index, cache->tags[base + way]);
+        }
+        if(cache->blockIndex != NULL){
+            hashMapRemove(cache->blockIndex, cache->tags[base + way]);
+        }
+    }
+    else{
+        setValid(cache, base + way);
+        if(cache->validCounts != NULL){
+            cache->validCounts[index] ++;
+        }
+    }
+    cache->tags[base + way] = tag;
+    if(dirty){
+        setDirty(cache, base + way);
+    }
+    else{
+        clearDirty(cache, base + way);
+    }
+    if(cache->blockIndex != NULL){
+        hashMapPut(cache->blockIndex, tag, way);
+    }
+    insertWay(&cache->replacement, index, way, 0, cache->replacement.policy);
+    return evicted;
+}
+
+//a hit on a valid way
+void touchBlock(struct Cache *cache, unsigned long index, int way){
+    touchWay(&cache->replacement, index, way, 0, cache->replacement.policy);
+}
+
+//returns whether the block was dirty
+bool invalidateBlock(struct Cache *cache, unsigned long index, int way){
+    unsigned long base = index * cache->associativity;
+    bool dirty = isDirty(cache, base + way);
+    clearValid(cache, base + way);
+    clearDirty(cache, base + way);
+    if(cache->validCounts != NULL){
+        cache->validCounts[index] --;
+    }
+    if(cache->blockIndex != NULL){
+        hashMapRemove(cache->blockIndex, cache->tags[base + way]);
+    }
+    return dirty;
+}
@@ -0,0 +1,146 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "hashmap.h"
+#include "replacement.h"
+
+//how findBlock/fillBlock scan a whole set, best one the cpu supports is picked at runtime
+enum SetScan{
+    SCAN_SCALAR,
+    SCAN_SSE42,
+    SCAN_AVX2
+};
+
+//how writes reach memory, write through with write allocate is the original model
+//  write back: a write only dirties the cached block, which is written out when evicted
+//  no write allocate: a write miss goes straight to memory without filling a block
+struct WritePolicy{
+    bool writeBack;
+    bool writeAllocate;
+};
+
+static inline bool defaultWritePolicy(struct WritePolicy writes){
+    return !writes.writeBack && writes.writeAllocate;
+}
+
+//fillBlock results
+#define EVICTED 1
+#define EVICTED_DIRTY 2
+
+//Flat set/way storage: way w of set s lives in slot s * associativity + w of every array,
+//and all arrays are carved out of one allocation so a probe touches one contiguous run of tags.
+//The address split is worked out once here instead of on every record. Sets wider than 64 ways
+//also count their valid ways, and a fully associative one of those looks blocks up by tag in
+//blockIndex instead of scanning.
+struct Cache{
+    int numSets;
+    int associativity;
+    int blockSize;
+    int offsetBits;
+    int indexBits;
+    unsigned long indexMask;
+    unsigned long *tags;
+    unsigned long *validBits;
+    unsigned long *dirtyBits;
+    int *validCounts;
+    struct HashMap *blockIndex;
+    struct Replacement replacement;
+    //tags, valid and dirty bits, valid counts and replacement state are this many bytes
+    //starting at tags
+    size_t stateBytes;
+    //bit i set when tags[i] == tag, for the first ways (at most 64) tags of a set
+    unsigned long (*matchTags)(const unsigned long *tags, unsigned long tag, int ways);
+};
+
+struct Cache *newCache(int numSets, int associativity, int blockSize, enum ReplacementPolicy policy);
+void freeCache(struct Cache *cache);
+bool writeCacheState(struct Cache *cache, FILE *file);
+bool readCacheState(struct Cache *cache, FILE *file);
+enum SetScan bestSetScan(void);
+void useSetScan(struct Cache *cache, enum SetScan scan);
+const char *setScanName(enum SetScan scan);
+
+unsigned long computeIndex(unsigned long address, int numSets, int blockSize);
+unsigned long computeTag(unsigned long address, int numSets, int blockSize);
+unsigned long blockAddress(struct Cache *cache, unsigned long index, unsigned long tag);
+
+static inline unsigned long cacheIndex(struct Cache *cache, unsigned long address){
+    return (address >> cache->offsetBits) & cache->indexMask;
+}
+
+static inline unsigned long cacheTag(struct Cache *cache, unsigned long address){
+    return address >> (cache->offsetBits + cache->indexBits);
+}
+
+static inline bool isValid(struct Cache *cache, unsigned long slot){
+    return (cache->validBits[slot >> 6] >> (slot & 63)) & 1;
+}
+
+static inline void setValid(struct Cache *cache, unsigned long slot){
+    cache->validBits[slot >> 6] |= 1UL << (slot & 63);
+}
+
+static inline void clearValid(struct Cache *cache, unsigned long slot){
+    cache->validBits[slot >> 6] &= ~(1UL << (slot & 63));
+}
+
+static inline bool isDirty(struct Cache *cache, unsigned long slot){
+    return (cache->dirtyBits[slot >> 6] >> (slot & 63)) & 1;
+}
+
+static inline void setDirty(struct Cache *cache, unsigned long slot){
+    cache->dirtyBits[slot >> 6] |= 1UL << (slot & 63);
+}
+
+static inline void clearDirty(struct Cache *cache, unsigned long slot){
+    cache->dirtyBits[slot >> 6] &= ~(1UL << (slot & 63));
+}
+
+int findBlock(struct Cache *cache, unsigned long index, unsigned long tag);
+int fillBlock(struct Cache *cache, unsigned long index, unsigned long tag, bool dirty, unsigned long *evictedAddress);
+void touchBlock(struct Cache *cache, unsigned long index, int way);
+bool invalidateBlock(struct Cache *cache, unsigned long index, int way);
+
+//Versions of findBlock and fillBlock for an associativity known at compile time. ways must be
+//a power of two no larger than 64, so a set's valid bits sit together in one word and the way
+//loops unroll completely.
+static inline __attribute__((always_inline)) unsigned long fullSet(const int ways){
+    return ways == 64 ? ~0UL : (1UL << ways) - 1;
+}
+
+static inline __attribute__((always_inline)) unsigned long setValidBits(struct Cache *cache, unsigned long base, const int ways){
+    return (cache->validBits[base >> 6] >> (base & 63)) & fullSet(ways);
+}
+
+static inline __attribute__((always_inline)) int findWay(struct Cache *cache, unsigned long index, unsigned long tag, const int ways){
+    unsigned long base = index * ways;
+    unsigned long valid = setValidBits(cache, base, ways);
+    unsigned long *tags = &cache->tags[base];
+    //valid tags in a set are unique, so at most one way matches
+    int way = -1;
+#pragma GCC unroll 16
+    for(int i = 0; i < ways; i ++){
+        way = (tags[i] == tag && ((valid >> i) & 1)) ? i : way;
+    }
+    return way;
+}
+
+static inline __attribute__((always_inline)) void fillWay(struct Cache *cache, unsigned long index, unsigned long tag, const int ways, const enum ReplacementPolicy policy){
+    unsigned long base = index * ways;
+    unsigned long valid = setValidBits(cache, base, ways);
+    int way;
+    if(valid != fullSet(ways)){
+        //first invalid way
+        way = __builtin_ctzl(~valid);
+        setValid(cache, base + way);
+    }
+    else{
+        way = victimWay(&cache->replacement, index, ways, policy);
+    }
+    cache->tags[base + way] = tag;
+    insertWay(&cache->replacement, index, way, ways, policy);
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include <stdlib.h>
+#include "hashmap.h"
+
+static unsigned long slotFor(struct HashMap *map, unsigned long key){
+    return (key * 0x9E3779B97F4A7C15UL) >> 17 & (map->capacity - 1);
+}
+
+struct HashMap *newHashMap(unsigned long expectedCount){
+    struct HashMap *map = malloc(sizeof(struct HashMap));
+    map->capacity = 16;
+    while(map->capacity < expectedCount * 2){
+        map->capacity *= 2;
+    }
+    map->count = 0;
+    map->keys = calloc(map->capacity, sizeof(unsigned long));
+    map->values = malloc(map->capacity * sizeof(unsigned long));
+    return map;
+}
+
+void freeHashMap(struct HashMap *map){
+    free(map->keys);
+    free(map->values);
+    free(map);
+}
+
+bool hashMapGet(struct HashMap *map, unsigned long key, unsigned long *value){
+    unsigned long stored = key + 1;
+    for(unsigned long slot = slotFor(map, key); map->keys[slot] != 0; slot = (slot + 1) & (map->capacity - 1)){
+        if(map->keys[slot] == stored){
+            if(value != NULL){
+                *value = map->values[slot];
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static void grow(struct HashMap *map){
+    unsigned long *oldKeys = map->keys;
+    unsigned long *oldValues = map->values;
+    unsigned long oldCapacity = map->capacity;
+    map->capacity *= 2;
+    map->count = 0;
+    map->keys = calloc(map->capacity, sizeof(unsigned long));
+    map->values = malloc(map->capacity * sizeof(unsigned long));
+    for(unsigned long i = 0; i < oldCapacity; i ++){
+        if(oldKeys[i] != 0){
+            hashMapPut(map, oldKeys[i] - 1, oldValues[i]);
+        }
+    }
+    free(oldKeys);
+    free(oldValues);
+}
+
+//insert the key or overwrite its value
+void hashMapPut(struct HashMap *map, unsigned long key, unsigned long value){
+    if((map->count + 1) * 2 > map->capacity){
+        grow(map);
+    }
+    unsigned long stored = key + 1;
+    unsigned long slot = slotFor(map, key);
+    while(map->keys[slot] != 0 && map->keys[slot] != stored){
+        slot = (slot + 1) & (map->capacity - 1);
+    }
+    if(map->keys[slot] == 0){
+        map->keys[slot] = stored;
+        map->count ++;
+    }
+    map->values[slot] = value;
+}
+
+bool hashMapRemove(struct HashMap *map, unsigned long key){
+    unsigned long mask = map->capacity - 1;
+    unsigned long stored = key + 1;
+    unsigned long slot = slotFor(map, key);
+    while(map->keys[slot] != stored){
+        if(map->keys[slot] == 0){
+            return false;
+        }
+        slot = (slot + 1) & mask;
+    }
+    //shift later entries of the probe run back so lookups never stop at the hole
+    unsigned long hole = slot;
+    for(unsigned long next = (hole + 1) & mask; map->keys[next] != 0; next = (next + 1) & mask){
+        unsigned long home = slotFor(map, map->keys[next] - 1);
+        if(((next - home) & mask) >= ((next - hole) & mask)){
+            map->keys[hole] = map->keys[next];
+            map->values[hole] = map->values[next];
+            hole = next;
+        }
+    }
+    map->keys[hole] = 0;
+    map->count --;
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <stdbool.h>
+
+//Open addressing map from unsigned long keys to unsigned long values with linear probing
+//and backward shift deletion. Keys are stored plus one so an empty slot is 0, which means
+//the key ~0UL can't be stored (block addresses never get that high).
+struct HashMap{
+    unsigned long *keys;
+    unsigned long *values;
+    unsigned long capacity;
+    unsigned long count;
+};
+
+struct HashMap *newHashMap(unsigned long expectedCount);
+void freeHashMap(struct HashMap *map);
+bool hashMapGet(struct HashMap *map, unsigned long key, unsigned long *value);
+void hashMapPut(struct HashMap *map, unsigned long key, unsigned long value);
+bool hashMapRemove(struct HashMap *map, unsigned long key);
+
+#endif
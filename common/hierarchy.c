@@ -0,0 +1,613 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "hierarchy.h"
+
+bool validGeometry(int cacheSize, int associativity, int blockSize){
+    return associativity > 0 && blockSize > 0 && (long)associativity * blockSize <= cacheSize && cacheSize % (associativity * blockSize) == 0;
+}
+
+struct Hierarchy *newHierarchy(struct LevelConfig *configs, int numLevels, int blockSize, enum Inclusion inclusion){
+    struct Hierarchy *hierarchy = calloc(1, sizeof(struct Hierarchy));
+    hierarchy->numLevels = numLevels;
+    hierarchy->blockSize = blockSize;
+    hierarchy->inclusion = inclusion;
+    hierarchy->writes.writeAllocate = true;
+    for(int i = 0; i < numLevels; i ++){
+        struct Level *level = &hierarchy->levels[i];
+        level->config = configs[i];
+        level->numSets = configs[i].cacheSize / configs[i].associativity / blockSize;
+        level->cache = newCache(level->numSets, configs[i].associativity, blockSize, parsePolicy(configs[i].policy));
+        if(level->cache == NULL){
+            //free only the levels allocated so far
+            hierarchy->numLevels = i;
+            freeHierarchy(hierarchy);
+            return NULL;
+        }
+    }
+    return hierarchy;
+}
+
+void freeHierarchy(struct Hierarchy *hierarchy){
+    if(hierarchy->prefetcher != NULL){
+        freePrefetcher(hierarchy->prefetcher);
+    }
+    for(int i = 0; i < hierarchy->numLevels; i ++){
+        freeCache(hierarchy->levels[i].cache);
+    }
+    free(hierarchy);
+}
+
+static const char *inclusionNames[] = {[INCLUSION_INCLUSIVE] = "inclusive", [INCLUSION_EXCLUSIVE] = "exclusive", [INCLUSION_NINE] = "nine"};
+
+bool parseInclusion(const char *name, enum Inclusion *inclusion){
+    for(int i = INCLUSION_INCLUSIVE; i <= INCLUSION_NINE; i ++){
+        if(strcmp(name, inclusionNames[i]) == 0){
+            *inclusion = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *inclusionName(enum Inclusion inclusion){
+    return inclusionNames[inclusion];
+}
+
+//a hierarchy file has one setting or level per line, levels listed from the L1 outwards:
+//    block 64
+//    inclusion inclusive|exclusive|nine
+//    write through|back
+//    allocate yes|no
+//    prefetch nextline|stride|stream[:degree[:distance]] [latency]
+//    level 32768 assoc:8 lru
+//    level 262144 assoc:8 lru
+//block defaults to 64, inclusion to exclusive and writes to write through with write allocate,
+//returns NULL (after saying why) on error
+struct Hierarchy *readHierarchyFile(const char *path){
+    FILE *file = fopen(path, "r");
+    if(file == NULL){
+        return NULL;
+    }
+    struct LevelConfig configs[MAX_LEVELS];
+    int numLevels = 0;
+    int blockSize = 64;
+    enum Inclusion inclusion = INCLUSION_EXCLUSIVE;
+    struct WritePolicy writes = {.writeBack = false, .writeAllocate = true};
+    bool prefetch = false;
+    struct PrefetchConfig prefetchConfig;
+    bool ok = true;
+    char line[1024];
+    while(ok && fgets(line, sizeof(line), file) != NULL){
+        char *fields[4];
+        int numFields = 0;
+        char *save;
+        for(char *field = strtok_r(line, " \t\r\n", &save); field != NULL && numFields < 4; field = strtok_r(NULL, " \t\r\n", &save)){
+            fields[numFields ++] = field;
+        }
+        if(numFields == 0 || fields[0][0] == '#'){
+            continue;
+        }
+        if(strcmp(fields[0], "block") == 0 && numFields == 2){
+            blockSize = atoi(fields[1]);
+        }
+        else if(strcmp(fields[0], "inclusion") == 0 && numFields == 2){
+            if(!parseInclusion(fields[1], &inclusion)){
+                fprintf(stderr, "unknown inclusion policy %s\n", fields[1]);
+                ok = false;
+            }
+        }
+        else if(strcmp(fields[0], "write") == 0 && numFields == 2 && (strcmp(fields[1], "through") == 0 || strcmp(fields[1], "back") == 0)){
+            writes.writeBack = strcmp(fields[1], "back") == 0;
+        }
+        else if(strcmp(fields[0], "allocate") == 0 && numFields == 2 && (strcmp(fields[1], "yes") == 0 || strcmp(fields[1], "no") == 0)){
+            writes.writeAllocate = strcmp(fields[1], "yes") == 0;
+        }
+        else if(strcmp(fields[0], "prefetch") == 0 && (numFields == 2 || numFields == 3)){
+            prefetch = parsePrefetchConfig(fields[1], &prefetchConfig);
+            if(!prefetch){
+                fprintf(stderr, "bad prefetcher %s\n", fields[1]);
+                ok = false;
+            }
+            else if(numFields == 3){
+                prefetchConfig.latency = atoi(fields[2]);
+            }
+        }
+        else if(strcmp(fields[0], "level") == 0 && numFields == 4 && strncmp(fields[2], "assoc:", 6) == 0){
+            if(numLevels == MAX_LEVELS){
+                fprintf(stderr, "at most %d levels\n", MAX_LEVELS);
+                ok = false;
+                continue;
+            }
+            configs[numLevels].cacheSize = atoi(fields[1]);
+            configs[numLevels].associativity = atoi(&fields[2][6]);
+            snprintf(configs[numLevels].policy, sizeof(configs[numLevels].policy), "%s", fields[3]);
+            numLevels ++;
+        }
+        else{
+            fprintf(stderr, "bad hierarchy line starting with %s\n", fields[0]);
+            ok = false;
+        }
+    }
+    fclose(file);
+    for(int i = 0; ok && i < numLevels; i ++){
+        if(!validGeometry(configs[i].cacheSize, configs[i].associativity, blockSize)){
+            fprintf(stderr, "level %d: %d bytes don't divide into %d way sets of %d byte blocks\n", i + 1, configs[i].cacheSize, configs[i].associativity, blockSize);
+            ok = false;
+        }
+    }
+    if(ok && numLevels == 0){
+        fprintf(stderr, "no levels in %s\n", path);
+        ok = false;
+    }
+    if(!ok){
+        return NULL;
+    }
+    struct Hierarchy *hierarchy = newHierarchy(configs, numLevels, blockSize, inclusion);
+    if(hierarchy == NULL){
+        fprintf(stderr, "can't allocate the caches of %s\n", path);
+        return NULL;
+    }
+    hierarchy->writes = writes;
+    if(prefetch){
+        hierarchy->prefetcher = newPrefetcher(prefetchConfig, blockSize);
+    }
+    return hierarchy;
+}
+
+//a dirty block leaving the level above is written into the first level from here down that
+//holds it, or to memory
+static void writeBackBlock(struct Hierarchy *hierarchy, int level, unsigned long address){
+    for(; level < hierarchy->numLevels; level ++){
+        struct Cache *cache = hierarchy->levels[level].cache;
+        unsigned long index = cacheIndex(cache, address);
+        int way = findBlock(cache, index, cacheTag(cache, address));
+        if(way >= 0){
+            setDirty(cache, index * cache->associativity + way);
+            return;
+        }
+    }
+    hierarchy->memWrites ++;
+}
+
+//inclusion: a block leaving this level can't stay in any level above it
+//returns whether any of the copies above was dirty
+static bool backInvalidate(struct Hierarchy *hierarchy, int level, unsigned long address){
+    bool dirty = false;
+    for(int i = 0; i < level; i ++){
+        struct Cache *cache = hierarchy->levels[i].cache;
+        unsigned long index = cacheIndex(cache, address);
+        int way = findBlock(cache, index, cacheTag(cache, address));
+        if(way < 0){
+            continue;
+        }
+        if(invalidateBlock(cache, index, way)){
+            hierarchy->levels[i].dirtyEvictions ++;
+            dirty = true;
+        }
+        if(i == 0 && hierarchy->prefetcher != NULL){
+            notePrefetchEviction(hierarchy->prefetcher, address);
+        }
+    }
+    return dirty;
+}
+
+//The one fill path: put the block holding address into a level, then deal with whatever it
+//pushed out. An exclusive victim moves down to the next level (and off the last one), an
+//inclusive victim is removed from the levels above, a nine victim just goes. Dirty victims
+//(and dirty copies an inclusive eviction removes) are written back on the way out. A
+//prefetched exclusive victim stays outstanding as it moves down and is only useless once it
+//falls off the last level.
+static inline __attribute__((always_inline)) void fillLevel(struct Hierarchy *hierarchy, int level, unsigned long address, bool dirty, const enum Inclusion inclusion){
+    while(level < hierarchy->numLevels){
+        struct Cache *cache = hierarchy->levels[level].cache;
+        unsigned long evictedAddress;
+        int evicted = fillBlock(cache, cacheIndex(cache, address), cacheTag(cache, address), dirty, &evictedAddress);
+        if(evicted == 0){
+            return;
+        }
+        if(level == 0 && inclusion != INCLUSION_EXCLUSIVE && hierarchy->prefetcher != NULL){
+            notePrefetchEviction(hierarchy->prefetcher, evictedAddress);
+        }
+        if(hierarchy->stats != NULL){
+            countSetConflict(hierarchy->stats, level, cacheIndex(cache, address));
+        }
+        dirty = (evicted & EVICTED_DIRTY) != 0;
+        if(dirty){
+            hierarchy->levels[level].dirtyEvictions ++;
+        }
+        if(inclusion == INCLUSION_INCLUSIVE){
+            if(backInvalidate(hierarchy, level, evictedAddress) || dirty){
+                writeBackBlock(hierarchy, level + 1, evictedAddress);
+            }
+            return;
+        }
+        if(inclusion == INCLUSION_NINE){
+            if(dirty){
+                writeBackBlock(hierarchy, level + 1, evictedAddress);
+            }
+            return;
+        }
+        address = evictedAddress;
+        level ++;
+    }
+    //an exclusive victim fell off the last level
+    if(dirty){
+        hierarchy->memWrites ++;
+    }
+    if(hierarchy->prefetcher != NULL){
+        notePrefetchEviction(hierarchy->prefetcher, address);
+    }
+}
+
+//train the prefetcher on a demand access and bring the blocks it asks for into the L1, from the
+//first level below that has them or from memory, the same way a read miss would
+static void runPrefetcher(struct Hierarchy *hierarchy, unsigned long address, const enum Inclusion inclusion){
+    struct Prefetcher *prefetcher = hierarchy->prefetcher;
+    unsigned long blocks[MAX_PREFETCH_DEGREE];
+    int count = prefetchCandidates(prefetcher, address, blocks);
+    for(int i = 0; i < count; i ++){
+        int level = 0;
+        int way = -1;
+        unsigned long index = 0;
+        for(; level < hierarchy->numLevels; level ++){
+            struct Cache *cache = hierarchy->levels[level].cache;
+            index = cacheIndex(cache, blocks[i]);
+            way = findBlock(cache, index, cacheTag(cache, blocks[i]));
+            if(way >= 0){
+                break;
+            }
+        }
+        if(level == 0){
+            continue;
+        }
+        bool dirty = false;
+        if(level == hierarchy->numLevels){
+            hierarchy->memReads ++;
+        }
+        else if(inclusion == INCLUSION_EXCLUSIVE){
+            dirty = invalidateBlock(hierarchy->levels[level].cache, index, way);
+        }
+        notePrefetch(prefetcher, blocks[i], level == hierarchy->numLevels);
+        if(inclusion == INCLUSION_EXCLUSIVE){
+            fillLevel(hierarchy, 0, blocks[i], dirty, inclusion);
+        }
+        else{
+            for(int j = level - 1; j >= 0; j --){
+                fillLevel(hierarchy, j, blocks[i], false, inclusion);
+            }
+        }
+    }
+}
+
+//The per record loop, stamped out once per inclusion policy (and with and without per set
+//instrumentation) so its checks fold away. Hits in the L1 are by far the common case and stay
+//on a short path with the counters in registers.
+static inline __attribute__((always_inline)) void runHierarchy(struct Hierarchy *hierarchy, struct TraceRecord *records, int count, const enum Inclusion inclusion, const bool instrumented){
+    struct Level *levels = hierarchy->levels;
+    struct Cache *L1Cache = levels[0].cache;
+    int numLevels = hierarchy->numLevels;
+    bool writeBack = hierarchy->writes.writeBack;
+    bool writeAllocate = hierarchy->writes.writeAllocate;
+    struct Prefetcher *prefetcher = hierarchy->prefetcher;
+    struct StatsStream *stats = hierarchy->stats;
+    long L1Hits = 0;
+    long memReads = 0;
+    long memWrites = 0;
+    for(int r = 0; r < count; r ++){
+        unsigned long address = records[r].address;
+        bool write = records[r].memAction == 'W';
+        //write through sends every write to memory
+        memWrites += write && !writeBack;
+        if(prefetcher != NULL){
+            prefetcher->time ++;
+        }
+        unsigned long index = cacheIndex(L1Cache, address);
+        int way = findBlock(L1Cache, index, cacheTag(L1Cache, address));
+        if(instrumented){
+            countSetAccess(stats, 0, index, way < 0);
+        }
+        if(way >= 0){
+            L1Hits ++;
+            touchBlock(L1Cache, index, way);
+            if(write && writeBack){
+                setDirty(L1Cache, index * L1Cache->associativity + way);
+            }
+            //the first use of a prefetched block keeps the prefetcher going
+            if(prefetcher != NULL && notePrefetchHit(prefetcher, address)){
+                runPrefetcher(hierarchy, address, inclusion);
+            }
+            continue;
+        }
+        //find the first level below the L1 holding the block
+        levels[0].misses ++;
+        int level = 1;
+        for(; level < numLevels; level ++){
+            struct Cache *cache = levels[level].cache;
+            index = cacheIndex(cache, address);
+            way = findBlock(cache, index, cacheTag(cache, address));
+            if(instrumented){
+                countSetAccess(stats, level, index, way < 0);
+            }
+            if(way >= 0){
+                break;
+            }
+            levels[level].misses ++;
+        }
+        bool allocate = !write || writeAllocate;
+        bool dirty = write && writeBack;
+        if(level < numLevels){
+            struct Cache *cache = levels[level].cache;
+            levels[level].hits ++;
+            //a prefetched exclusive block can be first used after it moved below the L1, the
+            //prefetcher runs on this miss anyway
+            if(inclusion == INCLUSION_EXCLUSIVE && prefetcher != NULL){
+                notePrefetchHit(prefetcher, address);
+            }
+            //a write that doesn't allocate updates the block where it was found
+            if(!allocate){
+                touchBlock(cache, index, way);
+                if(dirty){
+                    setDirty(cache, index * cache->associativity + way);
+                }
+            }
+            //an exclusive block moves up out of the level it was found in, dirty or not
+            else if(inclusion == INCLUSION_EXCLUSIVE){
+                dirty = invalidateBlock(cache, index, way) || dirty;
+            }
+            else{
+                touchBlock(cache, index, way);
+            }
+        }
+        else if(!allocate){
+            //a write around every level, already counted if writing through
+            memWrites += writeBack;
+        }
+        else{
+            memReads ++;
+        }
+        //bring the block into the levels that missed, outermost first so a back invalidation
+        //can't remove a block that was just filled, only the L1 copy takes a write
+        if(allocate && inclusion == INCLUSION_EXCLUSIVE){
+            fillLevel(hierarchy, 0, address, dirty, inclusion);
+        }
+        else if(allocate){
+            for(int i = level - 1; i >= 0; i --){
+                fillLevel(hierarchy, i, address, i == 0 && dirty, inclusion);
+            }
+        }
+        if(prefetcher != NULL){
+            runPrefetcher(hierarchy, address, inclusion);
+        }
+    }
+    levels[0].hits += L1Hits;
+    hierarchy->memReads += memReads;
+    hierarchy->memWrites += memWrites;
+}
+
+//count accesses, misses and conflicts per set of every level from now on
+void setHierarchyStats(struct Hierarchy *hierarchy, struct StatsStream *stats){
+    hierarchy->stats = stats;
+    for(int i = 0; i < hierarchy->numLevels; i ++){
+        addStatsLevel(stats, hierarchy->levels[i].numSets);
+    }
+}
+
+void simulateHierarchy(void *hierarchyPointer, struct TraceRecord *records, int count){
+    struct Hierarchy *hierarchy = hierarchyPointer;
+    bool instrumented = hierarchy->stats != NULL;
+    switch(hierarchy->inclusion){
+        case INCLUSION_INCLUSIVE:
+            if(instrumented){
+                runHierarchy(hierarchy, records, count, INCLUSION_INCLUSIVE, true);
+            }
+            else{
+                runHierarchy(hierarchy, records, count, INCLUSION_INCLUSIVE, false);
+            }
+            break;
+        case INCLUSION_EXCLUSIVE:
+            if(instrumented){
+                runHierarchy(hierarchy, records, count, INCLUSION_EXCLUSIVE, true);
+            }
+            else{
+                runHierarchy(hierarchy, records, count, INCLUSION_EXCLUSIVE, false);
+            }
+            break;
+        case INCLUSION_NINE:
+            if(instrumented){
+                runHierarchy(hierarchy, records, count, INCLUSION_NINE, true);
+            }
+            else{
+                runHierarchy(hierarchy, records, count, INCLUSION_NINE, false);
+            }
+            break;
+    }
+}
+
+//the L1's hits and misses with the memory traffic, for the stats windows
+struct WindowTotals hierarchyTotals(void *hierarchyPointer){
+    struct Hierarchy *hierarchy = hierarchyPointer;
+    return (struct WindowTotals){hierarchy->levels[0].hits, hierarchy->levels[0].misses, hierarchy->memReads, hierarchy->memWrites};
+}
+
+//The part of the checkpoint that has to match the hierarchy it is loaded into, as fixed width
+//fields so the check never depends on struct padding:
+//  version, levels, block size, inclusion, write back, write allocate, prefetcher kind (-1
+//  without one), degree, distance, latency, then size, associativity and policy of every level
+static void checkpointHeader(struct Hierarchy *hierarchy, int64_t *fields){
+    memset(fields, 0, CHECKPOINT_HEADER_FIELDS * sizeof(int64_t));
+    struct Prefetcher *prefetcher = hierarchy->prefetcher;
+    int n = 0;
+    fields[n ++] = CHECKPOINT_VERSION;
+    fields[n ++] = hierarchy->numLevels;
+    fields[n ++] = hierarchy->blockSize;
+    fields[n ++] = hierarchy->inclusion;
+    fields[n ++] = hierarchy->writes.writeBack;
+    fields[n ++] = hierarchy->writes.writeAllocate;
+    fields[n ++] = prefetcher != NULL ? (int64_t)prefetcher->config.kind : -1;
+    fields[n ++] = prefetcher != NULL ? prefetcher->config.degree : 0;
+    fields[n ++] = prefetcher != NULL ? prefetcher->config.distance : 0;
+    fields[n ++] = prefetcher != NULL ? prefetcher->config.latency : 0;
+    for(int i = 0; i < hierarchy->numLevels; i ++){
+        fields[n ++] = hierarchy->levels[i].config.cacheSize;
+        fields[n ++] = hierarchy->levels[i].config.associativity;
+        fields[n ++] = hierarchy->levels[i].cache->replacement.policy;
+    }
+}
+
+//Writes the whole state of the hierarchy at position in the trace to path, going through a
+//temporary file renamed over path so a run killed mid write leaves the last checkpoint
+//intact. Returns false on any write error.
+bool saveCheckpoint(struct Hierarchy *hierarchy, const char *path, struct TracePosition *position){
+    char temporary[strlen(path) + 5];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    FILE *file = fopen(temporary, "wb");
+    if(file == NULL){
+        return false;
+    }
+    int64_t header[CHECKPOINT_HEADER_FIELDS];
+    checkpointHeader(hierarchy, header);
+    bool ok = fwrite(CHECKPOINT_MAGIC, 4, 1, file) == 1;
+    ok = ok && fwrite(header, sizeof(header), 1, file) == 1;
+    for(int i = 0; ok && i < hierarchy->numLevels; i ++){
+        struct Level *level = &hierarchy->levels[i];
+        long counters[] = {level->hits, level->misses, level->dirtyEvictions};
+        ok = fwrite(counters, sizeof(counters), 1, file) == 1 && writeCacheState(level->cache, file);
+    }
+    long totals[] = {hierarchy->memReads, hierarchy->memWrites};
+    ok = ok && fwrite(totals, sizeof(totals), 1, file) == 1;
+    ok = ok && fwrite(position, sizeof(*position), 1, file) == 1;
+    if(ok && hierarchy->prefetcher != NULL){
+        ok = writePrefetcherState(hierarchy->prefetcher, file);
+    }
+    ok = fclose(file) == 0 && ok;
+    if(!ok || rename(temporary, path) != 0){
+        remove(temporary);
+        return false;
+    }
+    return true;
+}
+
+//Restores a checkpoint written by saveCheckpoint() into a hierarchy of the same configuration
+//and sets position to where in which trace it was taken, for the caller to check against the
+//trace it runs. Without counters only the cache contents (and the prefetcher's training) come
+//back and every counter starts from zero, for starting new experiments from a warmed up state.
+enum CheckpointResult loadCheckpoint(struct Hierarchy *hierarchy, const char *path, bool counters, struct TracePosition *position){
+    FILE *file = fopen(path, "rb");
+    if(file == NULL){
+        return CHECKPOINT_UNREADABLE;
+    }
+    char magic[4];
+    int64_t expected[CHECKPOINT_HEADER_FIELDS];
+    int64_t header[CHECKPOINT_HEADER_FIELDS];
+    checkpointHeader(hierarchy, expected);
+    if(fread(magic, 4, 1, file) != 1 || memcmp(magic, CHECKPOINT_MAGIC, 4) != 0 || fread(header, sizeof(header), 1, file) != 1 || header[0] != CHECKPOINT_VERSION){
+        fclose(file);
+        return CHECKPOINT_UNREADABLE;
+    }
+    if(memcmp(header, expected, sizeof(header)) != 0){
+        fclose(file);
+        return CHECKPOINT_MISMATCH;
+    }
+    bool ok = true;
+    for(int i = 0; ok && i < hierarchy->numLevels; i ++){
+        struct Level *level = &hierarchy->levels[i];
+        long levelCounters[3];
+        ok = fread(levelCounters, sizeof(levelCounters), 1, file) == 1 && readCacheState(level->cache, file);
+        level->hits = levelCounters[0];
+        level->misses = levelCounters[1];
+        level->dirtyEvictions = levelCounters[2];
+    }
+    long totals[2];
+    ok = ok && fread(totals, sizeof(totals), 1, file) == 1;
+    ok = ok && fread(position, sizeof(*position), 1, file) == 1;
+    hierarchy->memReads = totals[0];
+    hierarchy->memWrites = totals[1];
+    if(ok && hierarchy->prefetcher != NULL){
+        ok = readPrefetcherState(hierarchy->prefetcher, file);
+    }
+    fclose(file);
+    if(!ok){
+        return CHECKPOINT_UNREADABLE;
+    }
+    if(!counters){
+        for(int i = 0; i < hierarchy->numLevels; i ++){
+            hierarchy->levels[i].hits = 0;
+            hierarchy->levels[i].misses = 0;
+            hierarchy->levels[i].dirtyEvictions = 0;
+        }
+        hierarchy->memReads = 0;
+        hierarchy->memWrites = 0;
+        if(hierarchy->prefetcher != NULL){
+            resetPrefetchCounters(hierarchy->prefetcher);
+        }
+    }
+    return CHECKPOINT_OK;
+}
+
+//the counters of the result lines, for extrapolating them from a sample
+int hierarchyCounters(void *hierarchyPointer, long *counters, char (*names)[SAMPLE_NAME_SIZE]){
+    struct Hierarchy *hierarchy = hierarchyPointer;
+    bool writeBacks = !defaultWritePolicy(hierarchy->writes);
+    int n = 0;
+    if(names != NULL){
+        snprintf(names[0], SAMPLE_NAME_SIZE, "memread");
+        snprintf(names[1], SAMPLE_NAME_SIZE, "memwrite");
+    }
+    counters[n ++] = hierarchy->memReads;
+    counters[n ++] = hierarchy->memWrites;
+    for(int i = 0; i < hierarchy->numLevels; i ++){
+        struct Level *level = &hierarchy->levels[i];
+        if(names != NULL){
+            snprintf(names[n], SAMPLE_NAME_SIZE, "l%dcachehit", i + 1);
+            snprintf(names[n + 1], SAMPLE_NAME_SIZE, "l%dcachemiss", i + 1);
+            if(writeBacks){
+                snprintf(names[n + 2], SAMPLE_NAME_SIZE, "l%ddirtyevictions", i + 1);
+                snprintf(names[n + 3], SAMPLE_NAME_SIZE, "l%dwritebackbytes", i + 1);
+            }
+        }
+        counters[n ++] = level->hits;
+        counters[n ++] = level->misses;
+        if(writeBacks){
+            counters[n ++] = level->dirtyEvictions;
+            counters[n ++] = level->dirtyEvictions * hierarchy->blockSize;
+        }
+    }
+    if(hierarchy->prefetcher != NULL){
+        prefetchCounters(hierarchy->prefetcher, &counters[n]);
+        for(int i = 0; names != NULL && i < NUM_PREFETCH_COUNTERS; i ++){
+            snprintf(names[n + i], SAMPLE_NAME_SIZE, "%s", prefetchCounterNames[i]);
+        }
+        n += NUM_PREFETCH_COUNTERS;
+    }
+    return n;
+}
+
+//the level every other level's set index includes, set sampling selects sets by its index
+int fewestSetsLevel(struct Hierarchy *hierarchy){
+    int fewest = 0;
+    for(int i = 1; i < hierarchy->numLevels; i ++){
+        if(hierarchy->levels[i].numSets < hierarchy->levels[fewest].numSets){
+            fewest = i;
+        }
+    }
+    return fewest;
+}
+
+//the two level output extended to any number of levels, the write back counters only appear
+//when the write policy isn't the original one and the prefetch counters with a prefetcher
+void printHierarchyResults(struct Hierarchy *hierarchy, FILE *out){
+    fprintf(out, "memread:%ld\nmemwrite:%ld\n", hierarchy->memReads, hierarchy->memWrites);
+    for(int i = 0; i < hierarchy->numLevels; i ++){
+        struct Level *level = &hierarchy->levels[i];
+        fprintf(out, "l%dcachehit:%ld\nl%dcachemiss:%ld\n", i + 1, level->hits, i + 1, level->misses);
+        if(!defaultWritePolicy(hierarchy->writes)){
+            fprintf(out, "l%ddirtyevictions:%ld\nl%dwritebackbytes:%ld\n", i + 1, level->dirtyEvictions, i + 1, level->dirtyEvictions * hierarchy->blockSize);
+        }
+    }
+    if(hierarchy->prefetcher != NULL){
+        printPrefetchStats(hierarchy->prefetcher, out, false);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include "cache.h"
+#include "trace.h"
+#include "prefetch.h"
+#include "stats.h"
+#include "sampling.h"
+
+#define MAX_LEVELS 8
+
+//how the contents of a level relate to the levels closer to the cpu
+//  inclusive: every block above is also here, evicting one here removes it from above
+//  exclusive: a block lives in one level only, hits move it up and victims move down a level
+//  nine: neither, levels fill and evict independently of each other
+enum Inclusion{
+    INCLUSION_INCLUSIVE,
+    INCLUSION_EXCLUSIVE,
+    INCLUSION_NINE
+};
+
+struct LevelConfig{
+    int cacheSize;
+    int associativity;
+    char policy[16];
+};
+
+struct Level{
+    struct LevelConfig config;
+    int numSets;
+    struct Cache *cache;
+    long hits;
+    long misses;
+    long dirtyEvictions;
+};
+
+//Any number of cache levels in front of memory sharing one block size and write policy. Level
+//0 is the L1. A miss in every level is a memory read, and memory writes are every write when
+//writing through or the write backs that leave the last level when writing back.
+struct Hierarchy{
+    int numLevels;
+    int blockSize;
+    enum Inclusion inclusion;
+    struct WritePolicy writes;
+    //NULL unless prefetching into the L1
+    struct Prefetcher *prefetcher;
+    //NULL unless instrumented, see setHierarchyStats()
+    struct StatsStream *stats;
+    struct Level levels[MAX_LEVELS];
+    long memReads;
+    long memWrites;
+};
+
+//Checkpoint files hold the configuration (which must match on load), then per level the
+//counters and the raw cache state (see writeCacheState()), the memory totals, the position in
+//the trace and the prefetcher's state. Integers are in native byte order, so a checkpoint
+//only loads on the kind of machine that wrote it. The --stats windows of a resumed run
+//restart at record 0 from the record it resumed at.
+#define CHECKPOINT_MAGIC "CKPT"
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_HEADER_FIELDS (10 + 3 * MAX_LEVELS)
+//the last records before a checkpoint are hashed to tell whether a trace is the one it was
+//taken on
+#define CHECKPOINT_FINGERPRINT_RECORDS 64
+
+//records simulated, the record count of a binary trace (0 for a text trace, whose length
+//isn't known up front) and the hash of the last CHECKPOINT_FINGERPRINT_RECORDS records
+struct TracePosition{
+    unsigned long records;
+    unsigned long traceRecords;
+    unsigned long fingerprint;
+};
+
+enum CheckpointResult{
+    CHECKPOINT_OK,
+    CHECKPOINT_UNREADABLE,
+    CHECKPOINT_MISMATCH
+};
+
+bool validGeometry(int cacheSize, int associativity, int blockSize);
+struct Hierarchy *newHierarchy(struct LevelConfig *configs, int numLevels, int blockSize, enum Inclusion inclusion);
+void freeHierarchy(struct Hierarchy *hierarchy);
+bool parseInclusion(const char *name, enum Inclusion *inclusion);
+const char *inclusionName(enum Inclusion inclusion);
+struct Hierarchy *readHierarchyFile(const char *path);
+void setHierarchyStats(struct Hierarchy *hierarchy, struct StatsStream *stats);
+void simulateHierarchy(void *hierarchy, struct TraceRecord *records, int count);
+struct WindowTotals hierarchyTotals(void *hierarchy);
+int hierarchyCounters(void *hierarchy, long *counters, char (*names)[SAMPLE_NAME_SIZE]);
+int fewestSetsLevel(struct Hierarchy *hierarchy);
+bool saveCheckpoint(struct Hierarchy *hierarchy, const char *path, struct TracePosition *position);
+enum CheckpointResult loadCheckpoint(struct Hierarchy *hierarchy, const char *path, bool counters, struct TracePosition *position);
+void printHierarchyResults(struct Hierarchy *hierarchy, FILE *out);
+
+#endif
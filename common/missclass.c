@@ -0,0 +1,90 @@
+#include <stdlib.h>
+#include "missclass.h"
+
+struct MissClassifier *newMissClassifier(int numBlocks){
+    struct MissClassifier *classifier = calloc(1, sizeof(struct MissClassifier));
+    classifier->blocks = newHashMap(numBlocks);
+    classifier->capacity = numBlocks;
+    classifier->slotBlocks = malloc(numBlocks * sizeof(unsigned long));
+    classifier->links = malloc(numBlocks * sizeof(struct RecencyLink));
+    classifier->list.oldest = -1;
+    classifier->list.newest = -1;
+    return classifier;
+}
+
+void freeMissClassifier(struct MissClassifier *classifier){
+    freeHashMap(classifier->blocks);
+    free(classifier->slotBlocks);
+    free(classifier->links);
+    free(classifier);
+}
+
+static void unlinkSlot(struct MissClassifier *classifier, int slot){
+    struct RecencyLink *link = &classifier->links[slot];
+    if(link->older >= 0){
+        classifier->links[link->older].newer = link->newer;
+    }
+    else{
+        classifier->list.oldest = link->newer;
+    }
+    if(link->newer >= 0){
+        classifier->links[link->newer].older = link->older;
+    }
+    else{
+        classifier->list.newest = link->older;
+    }
+}
+
+static void pushNewest(struct MissClassifier *classifier, int slot){
+    classifier->links[slot].older = classifier->list.newest;
+    classifier->links[slot].newer = -1;
+    if(classifier->list.newest >= 0){
+        classifier->links[classifier->list.newest].newer = slot;
+    }
+    else{
+        classifier->list.oldest = slot;
+    }
+    classifier->list.newest = slot;
+}
+
+//bring a block into the shadow cache, over its least recently used block once it is full
+static void shadowFill(struct MissClassifier *classifier, unsigned long block){
+    int slot;
+    if(classifier->used < classifier->capacity){
+        slot = classifier->used ++;
+    }
+    else{
+        slot = classifier->list.oldest;
+        unlinkSlot(classifier, slot);
+        hashMapPut(classifier->blocks, classifier->slotBlocks[slot], NOT_RESIDENT);
+    }
+    classifier->slotBlocks[slot] = block;
+    pushNewest(classifier, slot);
+    hashMapPut(classifier->blocks, block, slot);
+}
+
+//every access goes through the shadow cache, miss says whether the real cache missed
+void classifyAccess(struct MissClassifier *classifier, unsigned long block, bool miss){
+    unsigned long slot;
+    if(!hashMapGet(classifier->blocks, block, &slot)){
+        classifier->compulsory += miss;
+        shadowFill(classifier, block);
+    }
+    else if(slot == NOT_RESIDENT){
+        classifier->capacityMisses += miss;
+        shadowFill(classifier, block);
+    }
+    else{
+        classifier->conflict += miss;
+        if((int)slot != classifier->list.newest){
+            unlinkSlot(classifier, slot);
+            pushNewest(classifier, slot);
+        }
+    }
+}
+
+//as extra result lines, or as extra fields of a sweep row
+void printMissClasses(struct MissClassifier *classifier, FILE *out, bool row){
+    const char *format = row ? " compulsory:%ld capacity:%ld conflict:%ld" : "compulsory:%ld\ncapacity:%ld\nconflict:%ld\n";
+    fprintf(out, format, classifier->compulsory, classifier->capacityMisses, classifier->conflict);
+}
@@ -0,0 +1,37 @@
+#ifndef MISSCLASS_H
+#define MISSCLASS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "hashmap.h"
+#include "replacement.h"
+
+//the map value of a block that was touched before but isn't in the shadow cache any more
+#define NOT_RESIDENT (~0UL)
+
+//Splits the misses of a cache into the three Cs by running a fully associative LRU cache with
+//the same number of blocks alongside it:
+//  compulsory: the first access to the block
+//  capacity: the fully associative cache missed too
+//  conflict: only the set associative cache missed
+//One map serves both as the set of every block ever touched and as the shadow cache's index,
+//block -> shadow slot (or NOT_RESIDENT), so memory grows with the unique block footprint and
+//each access costs one lookup plus an O(1) move to the front of the recency list.
+struct MissClassifier{
+    struct HashMap *blocks;
+    int capacity;
+    int used;
+    unsigned long *slotBlocks;
+    struct RecencyLink *links;
+    struct RecencyList list;
+    long compulsory;
+    long capacityMisses;
+    long conflict;
+};
+
+struct MissClassifier *newMissClassifier(int numBlocks);
+void freeMissClassifier(struct MissClassifier *classifier);
+void classifyAccess(struct MissClassifier *classifier, unsigned long block, bool miss);
+void printMissClasses(struct MissClassifier *classifier, FILE *out, bool row);
+
+#endif
@@ -0,0 +1,234 @@
+#include <stdlib.h>
+#include <string.h>
+#include "prefetch.h"
+
+//<kind>[:degree[:distance]] with kind nextline, stride or stream, degree and distance default to 1
+bool parsePrefetchConfig(const char *text, struct PrefetchConfig *config){
+    static const char *kinds[] = {[PREFETCH_NEXT_LINE] = "nextline", [PREFETCH_STRIDE] = "stride", [PREFETCH_STREAM] = "stream"};
+    size_t length = strcspn(text, ":");
+    bool found = false;
+    for(int i = PREFETCH_NEXT_LINE; i <= PREFETCH_STREAM; i ++){
+        if(strlen(kinds[i]) == length && strncmp(text, kinds[i], length) == 0){
+            config->kind = i;
+            found = true;
+        }
+    }
+    config->degree = 1;
+    config->distance = 1;
+    config->latency = 0;
+    if(!found){
+        return false;
+    }
+    if(text[length] == ':'){
+        char *end;
+        config->degree = strtol(&text[length + 1], &end, 10);
+        if(*end == ':'){
+            config->distance = strtol(end + 1, &end, 10);
+        }
+        if(*end != '\0'){
+            return false;
+        }
+    }
+    return config->degree >= 1 && config->degree <= MAX_PREFETCH_DEGREE && config->distance >= 1;
+}
+
+struct Prefetcher *newPrefetcher(struct PrefetchConfig config, int blockSize){
+    struct Prefetcher *prefetcher = calloc(1, sizeof(struct Prefetcher));
+    prefetcher->config = config;
+    prefetcher->blockSize = blockSize;
+    prefetcher->outstanding = newHashMap(1024);
+    for(int i = 0; i < NUM_STREAMS; i ++){
+        prefetcher->streams[i].lastBlock = -1;
+    }
+    return prefetcher;
+}
+
+void freePrefetcher(struct Prefetcher *prefetcher){
+    freeHashMap(prefetcher->outstanding);
+    free(prefetcher);
+}
+
+//blocks step, step + direction, ... in the direction of travel, starting distance steps past block
+static int blocksAhead(struct Prefetcher *prefetcher, long block, long step, unsigned long *blocks){
+    int count = 0;
+    for(int i = 0; i < prefetcher->config.degree; i ++){
+        long target = block + step * (prefetcher->config.distance + i);
+        if(target >= 0){
+            blocks[count ++] = (unsigned long)target * prefetcher->blockSize;
+        }
+    }
+    return count;
+}
+
+//PC-less stride detection: the last miss in each region and the step to the one before it,
+//prefetching once the same step has been seen twice in a row
+static int strideCandidates(struct Prefetcher *prefetcher, long block, unsigned long address, unsigned long *blocks){
+    unsigned long region = address >> STRIDE_REGION_BITS;
+    struct StrideEntry *entry = &prefetcher->strides[(region * 0x9E3779B97F4A7C15UL) >> 58];
+    if(entry->region != region + 1){
+        entry->region = region + 1;
+        entry->lastBlock = block;
+        entry->stride = 0;
+        entry->confidence = 0;
+        return 0;
+    }
+    long stride = block - entry->lastBlock;
+    entry->lastBlock = block;
+    if(stride == 0){
+        return 0;
+    }
+    if(stride == entry->stride){
+        entry->confidence ++;
+    }
+    else{
+        entry->stride = stride;
+        entry->confidence = 0;
+    }
+    return entry->confidence >= 1 ? blocksAhead(prefetcher, block, stride, blocks) : 0;
+}
+
+//up to NUM_STREAMS ascending or descending runs of blocks, a miss near the end of a stream
+//sets or confirms its direction and prefetches ahead of it, any other miss starts a new
+//stream in place of the least recently used one
+static int streamCandidates(struct Prefetcher *prefetcher, long block, unsigned long *blocks){
+    struct Stream *oldest = &prefetcher->streams[0];
+    for(int i = 0; i < NUM_STREAMS; i ++){
+        struct Stream *stream = &prefetcher->streams[i];
+        long step = block - stream->lastBlock;
+        if(stream->lastBlock >= 0 && step != 0 && labs(step) <= STREAM_WINDOW){
+            int direction = step > 0 ? 1 : -1;
+            bool confirmed = stream->direction == direction;
+            stream->direction = direction;
+            stream->lastBlock = block;
+            stream->lastUse = prefetcher->time;
+            return confirmed ? blocksAhead(prefetcher, block, direction, blocks) : 0;
+        }
+        if(stream->lastUse < oldest->lastUse){
+            oldest = stream;
+        }
+    }
+    oldest->lastBlock = block;
+    oldest->direction = 0;
+    oldest->lastUse = prefetcher->time;
+    return 0;
+}
+
+//train on a demand miss (or first hit to a prefetched block) at address, and return the block
+//addresses to prefetch, at most MAX_PREFETCH_DEGREE of them
+int prefetchCandidates(struct Prefetcher *prefetcher, unsigned long address, unsigned long *blocks){
+    long block = address / prefetcher->blockSize;
+    switch(prefetcher->config.kind){
+        case PREFETCH_NEXT_LINE:
+            return blocksAhead(prefetcher, block, 1, blocks);
+        case PREFETCH_STRIDE:
+            return strideCandidates(prefetcher, block, address, blocks);
+        case PREFETCH_STREAM:
+            return streamCandidates(prefetcher, block, blocks);
+    }
+    return 0;
+}
+
+//a prefetch of a block that wasn't in the cache was issued
+void notePrefetch(struct Prefetcher *prefetcher, unsigned long blockAddress, bool fromMemory){
+    prefetcher->issued ++;
+    if(fromMemory){
+        prefetcher->reads ++;
+    }
+    hashMapPut(prefetcher->outstanding, blockAddress, prefetcher->time + prefetcher->config.latency);
+}
+
+//a demand hit, returns true if it was the first use of a prefetched block
+bool notePrefetchHit(struct Prefetcher *prefetcher, unsigned long address){
+    unsigned long blockAddress = address / prefetcher->blockSize * prefetcher->blockSize;
+    unsigned long arrival;
+    if(!hashMapGet(prefetcher->outstanding, blockAddress, &arrival)){
+        return false;
+    }
+    hashMapRemove(prefetcher->outstanding, blockAddress);
+    if(prefetcher->time < arrival){
+        prefetcher->late ++;
+    }
+    else{
+        prefetcher->useful ++;
+    }
+    return true;
+}
+
+//a block left the cache
+void notePrefetchEviction(struct Prefetcher *prefetcher, unsigned long blockAddress){
+    if(hashMapRemove(prefetcher->outstanding, blockAddress)){
+        prefetcher->useless ++;
+    }
+}
+
+//the training tables, counters and outstanding prefetches, for a checkpoint of the cache it
+//prefetches into
+bool writePrefetcherState(struct Prefetcher *prefetcher, FILE *file){
+    long counters[] = {prefetcher->issued, prefetcher->useful, prefetcher->late, prefetcher->useless, prefetcher->reads};
+    bool ok = fwrite(&prefetcher->time, sizeof(prefetcher->time), 1, file) == 1;
+    ok = ok && fwrite(counters, sizeof(counters), 1, file) == 1;
+    ok = ok && fwrite(prefetcher->strides, sizeof(prefetcher->strides), 1, file) == 1;
+    ok = ok && fwrite(prefetcher->streams, sizeof(prefetcher->streams), 1, file) == 1;
+    struct HashMap *outstanding = prefetcher->outstanding;
+    ok = ok && fwrite(&outstanding->count, sizeof(outstanding->count), 1, file) == 1;
+    for(unsigned long slot = 0; ok && slot < outstanding->capacity; slot ++){
+        if(outstanding->keys[slot] != 0){
+            unsigned long entry[2] = {outstanding->keys[slot] - 1, outstanding->values[slot]};
+            ok = fwrite(entry, sizeof(entry), 1, file) == 1;
+        }
+    }
+    return ok;
+}
+
+void resetPrefetchCounters(struct Prefetcher *prefetcher){
+    prefetcher->issued = 0;
+    prefetcher->useful = 0;
+    prefetcher->late = 0;
+    prefetcher->useless = 0;
+    prefetcher->reads = 0;
+}
+
+bool readPrefetcherState(struct Prefetcher *prefetcher, FILE *file){
+    long counters[5];
+    unsigned long count;
+    bool ok = fread(&prefetcher->time, sizeof(prefetcher->time), 1, file) == 1;
+    ok = ok && fread(counters, sizeof(counters), 1, file) == 1;
+    ok = ok && fread(prefetcher->strides, sizeof(prefetcher->strides), 1, file) == 1;
+    ok = ok && fread(prefetcher->streams, sizeof(prefetcher->streams), 1, file) == 1;
+    ok = ok && fread(&count, sizeof(count), 1, file) == 1;
+    if(!ok){
+        return false;
+    }
+    prefetcher->issued = counters[0];
+    prefetcher->useful = counters[1];
+    prefetcher->late = counters[2];
+    prefetcher->useless = counters[3];
+    prefetcher->reads = counters[4];
+    freeHashMap(prefetcher->outstanding);
+    prefetcher->outstanding = newHashMap(count > 1024 ? count : 1024);
+    for(unsigned long i = 0; i < count; i ++){
+        unsigned long entry[2];
+        if(fread(entry, sizeof(entry), 1, file) != 1){
+            return false;
+        }
+        hashMapPut(prefetcher->outstanding, entry[0], entry[1]);
+    }
+    return true;
+}
+
+//as extra result lines, or as extra fields of a sweep row
+const char *prefetchCounterNames[NUM_PREFETCH_COUNTERS] = {"prefetchissued", "prefetchuseful", "prefetchlate", "prefetchuseless", "prefetchreads"};
+
+//the counters printPrefetchStats() prints, in the same order
+void prefetchCounters(struct Prefetcher *prefetcher, long *counters){
+    counters[0] = prefetcher->issued;
+    counters[1] = prefetcher->useful;
+    counters[2] = prefetcher->late;
+    counters[3] = prefetcher->useless;
+    counters[4] = prefetcher->reads;
+}
+
+void printPrefetchStats(struct Prefetcher *prefetcher, FILE *out, bool row){
+    const char *format = row ? " prefetchissued:%ld prefetchuseful:%ld prefetchlate:%ld prefetchuseless:%ld prefetchreads:%ld" : "prefetchissued:%ld\nprefetchuseful:%ld\nprefetchlate:%ld\nprefetchuseless:%ld\nprefetchreads:%ld\n";
+    fprintf(out, format, prefetcher->issued, prefetcher->useful, prefetcher->late, prefetcher->useless, prefetcher->reads);
+}
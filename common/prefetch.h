@@ -0,0 +1,82 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "hashmap.h"
+
+#define MAX_PREFETCH_DEGREE 16
+#define STRIDE_TABLE_SIZE 64
+//a stride table entry covers one 4 KiB region, strides are only learned within a region
+#define STRIDE_REGION_BITS 12
+#define NUM_STREAMS 16
+//a miss this many blocks or fewer from a stream's last block continues the stream
+#define STREAM_WINDOW 4
+#define NUM_PREFETCH_COUNTERS 5
+
+enum PrefetcherKind{
+    PREFETCH_NEXT_LINE,
+    PREFETCH_STRIDE,
+    PREFETCH_STREAM
+};
+
+//degree is how many blocks one trigger prefetches, distance how many blocks ahead of the
+//trigger the first of them is, latency how many records a prefetch takes to arrive
+struct PrefetchConfig{
+    enum PrefetcherKind kind;
+    int degree;
+    int distance;
+    int latency;
+};
+
+struct StrideEntry{
+    unsigned long region;
+    long lastBlock;
+    long stride;
+    int confidence;
+};
+
+struct Stream{
+    long lastBlock;
+    int direction;
+    unsigned long lastUse;
+};
+
+//A prefetcher sitting on the miss path of the cache closest to the cpu. It trains on demand
+//misses and on the first demand hit to each prefetched block, and every block it brings in
+//stays in outstanding (block address -> arrival time) until it is used or evicted:
+//  useful: used after it arrived
+//  late: used before it arrived (still a hit, the demand only waited less)
+//  useless: evicted without ever being used (in an exclusive hierarchy, where blocks the L1
+//           evicts move down, only once it leaves the last level)
+//Prefetches of blocks already in the cache are dropped and not counted as issued. reads
+//counts the prefetches that had to come from memory.
+struct Prefetcher{
+    struct PrefetchConfig config;
+    int blockSize;
+    unsigned long time;
+    struct StrideEntry strides[STRIDE_TABLE_SIZE];
+    struct Stream streams[NUM_STREAMS];
+    struct HashMap *outstanding;
+    long issued;
+    long useful;
+    long late;
+    long useless;
+    long reads;
+};
+
+bool parsePrefetchConfig(const char *text, struct PrefetchConfig *config);
+struct Prefetcher *newPrefetcher(struct PrefetchConfig config, int blockSize);
+void freePrefetcher(struct Prefetcher *prefetcher);
+int prefetchCandidates(struct Prefetcher *prefetcher, unsigned long address, unsigned long *blocks);
+void notePrefetch(struct Prefetcher *prefetcher, unsigned long blockAddress, bool fromMemory);
+bool notePrefetchHit(struct Prefetcher *prefetcher, unsigned long address);
+void notePrefetchEviction(struct Prefetcher *prefetcher, unsigned long blockAddress);
+bool writePrefetcherState(struct Prefetcher *prefetcher, FILE *file);
+bool readPrefetcherState(struct Prefetcher *prefetcher, FILE *file);
+void resetPrefetchCounters(struct Prefetcher *prefetcher);
+extern const char *prefetchCounterNames[NUM_PREFETCH_COUNTERS];
+void prefetchCounters(struct Prefetcher *prefetcher, long *counters);
+void printPrefetchStats(struct Prefetcher *prefetcher, FILE *out, bool row);
+
+#endif
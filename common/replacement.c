@@ -0,0 +1,129 @@
+#include <string.h>
+#include "replacement.h"
+
+static int treeWordsFor(int associativity){
+    int span = associativity > 1 ? 1 << (64 - __builtin_clzl(associativity - 1)) : 1;
+    return (span + 63) / 64;
+}
+
+static int rrpvWordsFor(int associativity){
+    return (associativity + 31) / 32;
+}
+
+static const char *policyNames[NUM_POLICIES] = {
+    [POLICY_FIFO] = "fifo",
+    [POLICY_LRU] = "lru",
+    [POLICY_PLRU] = "plru",
+    [POLICY_SRRIP] = "srrip",
+    [POLICY_BRRIP] = "brrip",
+    [POLICY_RANDOM] = "random",
+    [POLICY_LFU] = "lfu"
+};
+
+enum ReplacementPolicy parsePolicy(const char *name){
+    for(int policy = 0; policy < NUM_POLICIES; policy ++){
+        if(strcmp(name, policyNames[policy]) == 0){
+            return policy;
+        }
+    }
+    return POLICY_FIFO;
+}
+
+const char *policyName(enum ReplacementPolicy policy){
+    return policyNames[policy];
+}
+
+size_t replacementBytes(int numSets, int associativity, enum ReplacementPolicy policy){
+    size_t numSlots = (size_t)numSets * associativity;
+    size_t rrpvBytes = lineAlign((size_t)numSets * rrpvWordsFor(associativity) * sizeof(unsigned long));
+    size_t randomBytes = lineAlign(numSets * sizeof(unsigned long));
+    switch(policy){
+        case POLICY_PLRU:
+            return lineAlign((size_t)numSets * treeWordsFor(associativity) * sizeof(unsigned long));
+        case POLICY_SRRIP:
+            return rrpvBytes;
+        case POLICY_BRRIP:
+            return rrpvBytes + randomBytes;
+        case POLICY_RANDOM:
+            return randomBytes;
+        case POLICY_LFU:
+            return lineAlign(numSlots);
+        case POLICY_FIFO:
+        case POLICY_LRU:
+            break;
+    }
+    if(associativity <= RANK_MAX_WAYS){
+        return lineAlign(numSets * sizeof(unsigned long));
+    }
+    return lineAlign(numSlots * sizeof(struct RecencyLink)) + lineAlign(numSets * sizeof(struct RecencyList));
+}
+
+//splitmix64, spreads consecutive set numbers into unrelated nonzero xorshift states
+static unsigned long mixSeed(unsigned long x){
+    x += 0x9E3779B97F4A7C15UL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9UL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBUL;
+    x ^= x >> 31;
+    return x != 0 ? x : 1;
+}
+
+//restart every set's random stream from seed, a no-op for the policies that don't use one
+void seedReplacement(struct Replacement *replacement, unsigned long seed){
+    if(replacement->random == NULL){
+        return;
+    }
+    for(int set = 0; set < replacement->numSets; set ++){
+        replacement->random[set] = mixSeed(seed * replacement->numSets + set);
+    }
+}
+
+//memory must hold replacementBytes() bytes, fifo and lru sets start ordered way 0 (oldest) to the last way
+void initReplacement(struct Replacement *replacement, int numSets, int associativity, enum ReplacementPolicy policy, void *memory){
+    memset(replacement, 0, sizeof(struct Replacement));
+    replacement->policy = policy;
+    replacement->associativity = associativity;
+    replacement->numSets = numSets;
+    replacement->treeWords = treeWordsFor(associativity);
+    replacement->rrpvWords = rrpvWordsFor(associativity);
+    if(policy == POLICY_PLRU){
+        replacement->tree = memory;
+        memset(replacement->tree, 0, replacementBytes(numSets, associativity, policy));
+    }
+    else if(policy == POLICY_SRRIP || policy == POLICY_BRRIP || policy == POLICY_RANDOM){
+        //every way starts distant, though a fill always sets the counter before it matters
+        size_t rrpvBytes = policy == POLICY_RANDOM ? 0 : lineAlign((size_t)numSets * replacement->rrpvWords * sizeof(unsigned long));
+        replacement->rrpv = rrpvBytes > 0 ? memory : NULL;
+        memset(memory, 0xFF, rrpvBytes);
+        if(policy != POLICY_SRRIP){
+            replacement->random = (unsigned long *)((char *)memory + rrpvBytes);
+            seedReplacement(replacement, DEFAULT_REPLACEMENT_SEED);
+        }
+    }
+    else if(policy == POLICY_LFU){
+        replacement->counts = memory;
+        memset(replacement->counts, 0, (size_t)numSets * associativity);
+    }
+    else if(associativity <= RANK_MAX_WAYS){
+        unsigned long rank = 0;
+        for(int way = 0; way < associativity; way ++){
+            rank |= (unsigned long)way << (4 * way);
+        }
+        replacement->ranks = memory;
+        for(int set = 0; set < numSets; set ++){
+            replacement->ranks[set] = rank;
+        }
+    }
+    else{
+        replacement->links = memory;
+        replacement->lists = (struct RecencyList *)((char *)memory + lineAlign((size_t)numSets * associativity * sizeof(struct RecencyLink)));
+        for(int set = 0; set < numSets; set ++){
+            struct RecencyLink *links = &replacement->links[(size_t)set * associativity];
+            for(int way = 0; way < associativity; way ++){
+                links[way].older = way - 1;
+                links[way].newer = way + 1 < associativity ? way + 1 : -1;
+            }
+            replacement->lists[set].oldest = 0;
+            replacement->lists[set].newest = associativity - 1;
+        }
+    }
+}
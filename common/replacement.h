@@ -0,0 +1,305 @@
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+//anything other than one of the names below keeps the original fifo behaviour
+enum ReplacementPolicy{
+    POLICY_FIFO,
+    POLICY_LRU,
+    POLICY_PLRU,
+    POLICY_SRRIP,
+    POLICY_BRRIP,
+    POLICY_RANDOM,
+    POLICY_LFU
+};
+
+#define NUM_POLICIES 7
+//sets up to this wide keep their recency order packed in one word
+#define RANK_MAX_WAYS 16
+//2 bit re-reference prediction values, 3 is "distant" and the first such way is the victim
+#define RRPV_MAX 3
+#define RRPV_LONG 2
+//brrip inserts at RRPV_LONG once every 2^BRRIP_BITS fills on average, otherwise at RRPV_MAX
+#define BRRIP_BITS 5
+#define LFU_MAX_COUNT 255
+#define DEFAULT_REPLACEMENT_SEED 1
+
+//round a byte count up to a cache line so each array starts on its own line, the cache arena
+//and the replacement state it holds are laid out with it
+static inline size_t lineAlign(size_t bytes){
+    return (bytes + 63) & ~(size_t)63;
+}
+
+//doubly linked recency list threaded through the ways of one set, oldest way first
+struct RecencyLink{
+    int older;
+    int newer;
+};
+
+struct RecencyList{
+    int oldest;
+    int newest;
+};
+
+//Per set replacement state, every update and victim choice is O(1) (tree-PLRU is O(log ways)).
+//fifo and lru both keep ways ordered oldest to newest and differ only in whether a hit moves
+//a way to the newest end:
+//  - sets of up to 16 ways pack the order into ranks[set], 4 bits per position with the
+//    oldest way in the low nibble
+//  - wider sets use an intrusive list through links[slot], with the ends in lists[set]
+//plru keeps treeWords words of tree bits per set (node n of the heap ordered tree is bit n,
+//a set bit means the victim is on the right).
+//srrip and brrip keep rrpvWords words of 2 bit counters per set, way w in bits 2w and 2w + 1
+//of its word. A hit sets the way's counter to 0 and a victim is the first way at RRPV_MAX,
+//ageing every way in the set until there is one.
+//random and brrip draw from a xorshift generator per set, so a set's choices don't depend on
+//how the other sets were used (or which thread simulated them).
+//lfu keeps a saturating use count per slot, the victim is the first way with the lowest.
+//The order of invalid ways never matters: a fill always takes the first invalid way, and
+//only a full set asks for a victim.
+struct Replacement{
+    enum ReplacementPolicy policy;
+    int associativity;
+    int numSets;
+    int treeWords;
+    int rrpvWords;
+    unsigned long *ranks;
+    struct RecencyLink *links;
+    struct RecencyList *lists;
+    unsigned long *tree;
+    unsigned long *rrpv;
+    unsigned long *random;
+    unsigned char *counts;
+};
+
+enum ReplacementPolicy parsePolicy(const char *name);
+const char *policyName(enum ReplacementPolicy policy);
+size_t replacementBytes(int numSets, int associativity, enum ReplacementPolicy policy);
+void initReplacement(struct Replacement *replacement, int numSets, int associativity, enum ReplacementPolicy policy, void *memory);
+void seedReplacement(struct Replacement *replacement, unsigned long seed);
+
+//All of the below take ways and policy as compile time constants where the caller knows them,
+//ways == 0 means the associativity is only known at runtime.
+static inline __attribute__((always_inline)) void promoteRank(unsigned long *rank, int way, int ways){
+    //find the nibble holding way: x has a zero nibble there, and the lowest flagged nibble of
+    //the usual zero nibble test is always exact
+    unsigned long x = *rank ^ (way * 0x1111111111111111UL);
+    unsigned long found = (x - 0x1111111111111111UL) & ~x & 0x8888888888888888UL;
+    int position = __builtin_ctzl(found) >> 2;
+    if(position == ways - 1){
+        return;
+    }
+    unsigned long below = *rank & ((1UL << (4 * position)) - 1);
+    unsigned long above = (*rank >> (4 * position + 4)) << (4 * position);
+    *rank = below | above | ((unsigned long)way << (4 * (ways - 1)));
+}
+
+static inline __attribute__((always_inline)) void promoteLink(struct Replacement *replacement, unsigned long set, int way){
+    struct RecencyList *list = &replacement->lists[set];
+    if(list->newest == way){
+        return;
+    }
+    struct RecencyLink *links = &replacement->links[set * replacement->associativity];
+    int older = links[way].older;
+    int newer = links[way].newer;
+    if(older >= 0){
+        links[older].newer = newer;
+    }
+    else{
+        list->oldest = newer;
+    }
+    links[newer].older = older;
+    links[way].older = list->newest;
+    links[way].newer = -1;
+    links[list->newest].newer = way;
+    list->newest = way;
+}
+
+static inline __attribute__((always_inline)) bool treeBit(unsigned long *tree, int node){
+    return (tree[node >> 6] >> (node & 63)) & 1;
+}
+
+//point every node on the way's path at the other half
+static inline __attribute__((always_inline)) void touchTree(struct Replacement *replacement, unsigned long set, int way, const int ways){
+    int associativity = ways > 0 ? ways : replacement->associativity;
+    unsigned long *tree = &replacement->tree[set * (ways > 0 && ways <= 64 ? 1 : replacement->treeWords)];
+    int span = associativity > 1 ? 1 << (64 - __builtin_clzl(associativity - 1)) : 1;
+    int node = 1;
+    int low = 0;
+    while(span > 1){
+        span >>= 1;
+        unsigned long bit = 1UL << (node & 63);
+        if(way < low + span){
+            tree[node >> 6] |= bit;
+            node = 2 * node;
+        }
+        else{
+            tree[node >> 6] &= ~bit;
+            node = 2 * node + 1;
+            low += span;
+        }
+    }
+}
+
+//follow the tree bits, never into a right half that is past the last way
+static inline __attribute__((always_inline)) int treeVictim(struct Replacement *replacement, unsigned long set, const int ways){
+    int associativity = ways > 0 ? ways : replacement->associativity;
+    unsigned long *tree = &replacement->tree[set * (ways > 0 && ways <= 64 ? 1 : replacement->treeWords)];
+    int span = associativity > 1 ? 1 << (64 - __builtin_clzl(associativity - 1)) : 1;
+    int node = 1;
+    int low = 0;
+    while(span > 1){
+        span >>= 1;
+        if(treeBit(tree, node) && low + span < associativity){
+            node = 2 * node + 1;
+            low += span;
+        }
+        else{
+            node = 2 * node;
+        }
+    }
+    return low;
+}
+
+static inline __attribute__((always_inline)) unsigned long nextRandom(struct Replacement *replacement, unsigned long set){
+    unsigned long x = replacement->random[set];
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    replacement->random[set] = x;
+    return x;
+}
+
+static inline __attribute__((always_inline)) unsigned long *rrpvWord(struct Replacement *replacement, unsigned long set, int way, const int ways){
+    return &replacement->rrpv[set * (ways > 0 && ways <= 32 ? 1 : replacement->rrpvWords) + (way >> 5)];
+}
+
+static inline __attribute__((always_inline)) void setRrpv(struct Replacement *replacement, unsigned long set, int way, unsigned long value, const int ways){
+    unsigned long *word = rrpvWord(replacement, set, way, ways);
+    int shift = 2 * (way & 31);
+    *word = (*word & ~(3UL << shift)) | (value << shift);
+}
+
+//scan for a counter at RRPV_MAX a word (32 ways) at a time, x & x >> 1 has the low bit of
+//each field set where both bits are, and with none found no field is at the maximum so adding
+//one to every field can't carry into the next
+static inline __attribute__((always_inline)) int rrpvVictim(struct Replacement *replacement, unsigned long set, const int ways){
+    int associativity = ways > 0 ? ways : replacement->associativity;
+    int words = ways > 0 && ways <= 32 ? 1 : replacement->rrpvWords;
+    unsigned long *rrpv = rrpvWord(replacement, set, 0, ways);
+    while(true){
+        for(int i = 0; i < words; i ++){
+            int fields = associativity - 32 * i < 32 ? associativity - 32 * i : 32;
+            unsigned long low = 0x5555555555555555UL >> (64 - 2 * fields);
+            unsigned long distant = rrpv[i] & (rrpv[i] >> 1) & low;
+            if(distant != 0){
+                return 32 * i + (__builtin_ctzl(distant) >> 1);
+            }
+        }
+        for(int i = 0; i < words; i ++){
+            int fields = associativity - 32 * i < 32 ? associativity - 32 * i : 32;
+            rrpv[i] += 0x5555555555555555UL >> (64 - 2 * fields);
+        }
+    }
+}
+
+static inline __attribute__((always_inline)) int lfuVictim(struct Replacement *replacement, unsigned long set, const int ways){
+    int associativity = ways > 0 ? ways : replacement->associativity;
+    unsigned char *counts = &replacement->counts[set * associativity];
+    int victim = 0;
+    for(int way = 1; way < associativity; way ++){
+        if(counts[way] < counts[victim]){
+            victim = way;
+        }
+    }
+    return victim;
+}
+
+//a hit: lru and plru make the way the most recent, the rrip policies predict it will be
+//re-referenced soon, lfu counts the use, fifo and random leave their state alone
+static inline __attribute__((always_inline)) void touchWay(struct Replacement *replacement, unsigned long set, int way, const int ways, const enum ReplacementPolicy policy){
+    int associativity = ways > 0 ? ways : replacement->associativity;
+    switch(policy){
+        case POLICY_LRU:
+            if(associativity <= RANK_MAX_WAYS){
+                promoteRank(&replacement->ranks[set], way, associativity);
+            }
+            else{
+                promoteLink(replacement, set, way);
+            }
+            break;
+        case POLICY_PLRU:
+            touchTree(replacement, set, way, ways);
+            break;
+        case POLICY_SRRIP:
+        case POLICY_BRRIP:
+            setRrpv(replacement, set, way, 0, ways);
+            break;
+        case POLICY_LFU:
+            if(replacement->counts[set * associativity + way] < LFU_MAX_COUNT){
+                replacement->counts[set * associativity + way] ++;
+            }
+            break;
+        case POLICY_FIFO:
+        case POLICY_RANDOM:
+            break;
+    }
+}
+
+//a fill: the recency policies treat the new block as the most recent, srrip predicts a long
+//re-reference interval and brrip mostly a distant one, lfu starts it at one use
+static inline __attribute__((always_inline)) void insertWay(struct Replacement *replacement, unsigned long set, int way, const int ways, const enum ReplacementPolicy policy){
+    int associativity = ways > 0 ? ways : replacement->associativity;
+    switch(policy){
+        case POLICY_FIFO:
+        case POLICY_LRU:
+            if(associativity <= RANK_MAX_WAYS){
+                promoteRank(&replacement->ranks[set], way, associativity);
+            }
+            else{
+                promoteLink(replacement, set, way);
+            }
+            break;
+        case POLICY_PLRU:
+            touchTree(replacement, set, way, ways);
+            break;
+        case POLICY_SRRIP:
+            setRrpv(replacement, set, way, RRPV_LONG, ways);
+            break;
+        case POLICY_BRRIP:
+            setRrpv(replacement, set, way, (nextRandom(replacement, set) & ((1 << BRRIP_BITS) - 1)) == 0 ? RRPV_LONG : RRPV_MAX, ways);
+            break;
+        case POLICY_LFU:
+            replacement->counts[set * associativity + way] = 1;
+            break;
+        case POLICY_RANDOM:
+            break;
+    }
+}
+
+//the way to evict from a full set
+static inline __attribute__((always_inline)) int victimWay(struct Replacement *replacement, unsigned long set, const int ways, const enum ReplacementPolicy policy){
+    int associativity = ways > 0 ? ways : replacement->associativity;
+    switch(policy){
+        case POLICY_FIFO:
+        case POLICY_LRU:
+            if(associativity <= RANK_MAX_WAYS){
+                return replacement->ranks[set] & 15;
+            }
+            return replacement->lists[set].oldest;
+        case POLICY_PLRU:
+            return treeVictim(replacement, set, ways);
+        case POLICY_SRRIP:
+        case POLICY_BRRIP:
+            return rrpvVictim(replacement, set, ways);
+        case POLICY_RANDOM:
+            return nextRandom(replacement, set) % associativity;
+        case POLICY_LFU:
+            return lfuVictim(replacement, set, ways);
+    }
+    return 0;
+}
+
+#endif
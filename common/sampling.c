@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sampling.h"
+#include "cache.h"
+
+//"period:warmup:measure", the measured records have to fit in the period after the warm up
+bool parseIntervalSampling(const char *text, struct SampleConfig *config){
+    unsigned long period;
+    unsigned long warmup;
+    unsigned long measure;
+    if(sscanf(text, "%lu:%lu:%lu", &period, &warmup, &measure) != 3 || measure == 0 || warmup + measure > period){
+        return false;
+    }
+    config->period = period;
+    config->warmup = warmup;
+    config->measure = measure;
+    return true;
+}
+
+//spreads neighbouring sets over the sample and the groups
+static unsigned long hashSet(unsigned long set){
+    unsigned long h = set * 0x9E3779B97F4A7C15UL;
+    return h ^ (h >> 32);
+}
+
+//numSets and blockSize give the index sets are selected by, returns NULL when set sampling
+//leaves fewer than two sets to simulate
+struct Sampler *newSampler(struct SampleConfig config, int numSets, int blockSize, void *simulator, CountersFunction countersOf){
+    struct Sampler *sampler = calloc(1, sizeof(struct Sampler));
+    sampler->config = config;
+    sampler->numSets = numSets;
+    sampler->blockSize = blockSize;
+    sampler->countersOf = countersOf;
+    long counters[SAMPLE_MAX_COUNTERS];
+    sampler->numCounters = countersOf(simulator, counters, sampler->names);
+    if(config.setRatio > 1){
+        sampler->setUnits = malloc(numSets);
+        int sampledSets = 0;
+        for(int set = 0; set < numSets; set ++){
+            unsigned long h = hashSet(set);
+            sampler->setUnits[set] = h % config.setRatio == 0 ? (signed char)(h / config.setRatio % SAMPLE_GROUPS) : -1;
+            sampledSets += sampler->setUnits[set] >= 0;
+        }
+        if(sampledSets < 2){
+            freeSampler(sampler);
+            return NULL;
+        }
+        sampler->numUnits = SAMPLE_GROUPS;
+        sampler->unitCapacity = SAMPLE_GROUPS;
+    }
+    else{
+        sampler->unitCapacity = 64;
+    }
+    sampler->units = calloc(sampler->unitCapacity, sizeof(struct SampleUnit));
+    return sampler;
+}
+
+//simulate records and add what the counters did to unit
+static void simulateUnit(struct Sampler *sampler, void *simulator, SimulateFunction simulate, struct SampleUnit *unit, struct TraceRecord *records, int count){
+    long before[SAMPLE_MAX_COUNTERS];
+    long after[SAMPLE_MAX_COUNTERS];
+    sampler->countersOf(simulator, before, NULL);
+    simulate(simulator, records, count);
+    sampler->countersOf(simulator, after, NULL);
+    for(int i = 0; i < sampler->numCounters; i ++){
+        unit->counters[i] += after[i] - before[i];
+    }
+    unit->records += count;
+    sampler->simulated += count;
+}
+
+//every batch is split by group, sets never interact so simulating a group's records apart
+//from the others' doesn't change any result
+static void runSampledSets(struct Sampler *sampler, struct TraceReader *reader, void *simulator, SimulateFunction simulate){
+    struct TraceRecord records[TRACE_BATCH_SIZE];
+    struct TraceRecord *groups = malloc(SAMPLE_GROUPS * TRACE_BATCH_SIZE * sizeof(struct TraceRecord));
+    int counts[SAMPLE_GROUPS];
+    int count;
+    while((count = readTraceBatch(reader, records, TRACE_BATCH_SIZE)) > 0){
+        sampler->records += count;
+        memset(counts, 0, sizeof(counts));
+        for(int r = 0; r < count; r ++){
+            int group = sampler->setUnits[computeIndex(records[r].address, sampler->numSets, sampler->blockSize)];
+            if(group >= 0){
+                groups[group * TRACE_BATCH_SIZE + counts[group] ++] = records[r];
+            }
+        }
+        for(int group = 0; group < SAMPLE_GROUPS; group ++){
+            if(counts[group] > 0){
+                simulateUnit(sampler, simulator, simulate, &sampler->units[group], &groups[group * TRACE_BATCH_SIZE], counts[group]);
+            }
+        }
+    }
+    free(groups);
+}
+
+//warm up, measure, then skip to the next period, skipping binary traces a chunk at a time
+static void runSampledIntervals(struct Sampler *sampler, struct TraceReader *reader, void *simulator, SimulateFunction simulate){
+    struct SampleConfig config = sampler->config;
+    struct TraceRecord records[TRACE_BATCH_SIZE];
+    while(true){
+        unsigned long phase = sampler->records % config.period;
+        if(phase >= config.warmup + config.measure){
+            unsigned long wanted = config.period - phase;
+            unsigned long skipped = skipTraceRecords(reader, wanted);
+            sampler->records += skipped;
+            if(skipped < wanted){
+                break;
+            }
+            continue;
+        }
+        unsigned long boundary = phase < config.warmup ? config.warmup : config.warmup + config.measure;
+        int wanted = boundary - phase < TRACE_BATCH_SIZE ? (int)(boundary - phase) : TRACE_BATCH_SIZE;
+        int count = readTraceBatch(reader, records, wanted);
+        if(count == 0){
+            break;
+        }
+        sampler->records += count;
+        if(phase < config.warmup){
+            simulate(simulator, records, count);
+            sampler->simulated += count;
+            continue;
+        }
+        if(phase == config.warmup){
+            if(sampler->numUnits == sampler->unitCapacity){
+                sampler->unitCapacity *= 2;
+                sampler->units = realloc(sampler->units, sampler->unitCapacity * sizeof(struct SampleUnit));
+            }
+            memset(&sampler->units[sampler->numUnits ++], 0, sizeof(struct SampleUnit));
+        }
+        simulateUnit(sampler, simulator, simulate, &sampler->units[sampler->numUnits - 1], records, count);
+    }
+}
+
+void runSampled(struct Sampler *sampler, struct TraceReader *reader, void *simulator, SimulateFunction simulate){
+    if(sampler->config.setRatio > 1){
+        runSampledSets(sampler, reader, simulator, simulate);
+    }
+    else{
+        runSampledIntervals(sampler, reader, simulator, simulate);
+    }
+}
+
+//The estimates in place of the exact result lines, then how much of the trace was simulated
+//and the half width of each estimate's 95% confidence interval:
+//  <counter>:<estimate>
+//  records:<records in the trace>
+//  sampledrecords:<records simulated, warm up included>
+//  <counter>error:<half width>
+//The error lines need at least two units with records in them.
+void printSampledResults(struct Sampler *sampler, FILE *out){
+    unsigned long unitRecords = 0;
+    int usedUnits = 0;
+    for(int u = 0; u < sampler->numUnits; u ++){
+        unitRecords += sampler->units[u].records;
+        usedUnits += sampler->units[u].records > 0;
+    }
+    double ratios[SAMPLE_MAX_COUNTERS];
+    for(int i = 0; i < sampler->numCounters; i ++){
+        long sum = 0;
+        for(int u = 0; u < sampler->numUnits; u ++){
+            sum += sampler->units[u].counters[i];
+        }
+        ratios[i] = unitRecords > 0 ? (double)sum / unitRecords : 0;
+        fprintf(out, "%s:%.0f\n", sampler->names[i], ratios[i] * sampler->records);
+    }
+    fprintf(out, "records:%lu\nsampledrecords:%lu\n", sampler->records, sampler->simulated);
+    if(usedUnits < 2){
+        return;
+    }
+    //the finite population correction, measuring the whole trace would leave no error
+    double unsampled = 1 - (double)unitRecords / sampler->records;
+    for(int i = 0; i < sampler->numCounters; i ++){
+        double squares = 0;
+        for(int u = 0; u < sampler->numUnits; u ++){
+            double residual = sampler->units[u].counters[i] - ratios[i] * sampler->units[u].records;
+            squares += residual * residual;
+        }
+        double variance = squares / (usedUnits - 1);
+        double error = 1.96 * sampler->records * sqrt(unsampled * usedUnits * variance) / unitRecords;
+        fprintf(out, "%serror:%.0f\n", sampler->names[i], error);
+    }
+}
+
+void freeSampler(struct Sampler *sampler){
+    free(sampler->setUnits);
+    free(sampler->units);
+    free(sampler);
+}
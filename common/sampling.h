@@ -0,0 +1,64 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "trace.h"
+#include "sweep.h"
+
+//sampled sets are split into this many groups, the units the error bounds are computed from
+#define SAMPLE_GROUPS 32
+//enough for every result line of an 8 level write back hierarchy with a prefetcher
+#define SAMPLE_MAX_COUNTERS 48
+#define SAMPLE_NAME_SIZE 32
+
+//every counter of a simulator that gets extrapolated, in output order, with their result line
+//names filled in when names isn't NULL; returns the number of counters
+typedef int (*CountersFunction)(void *simulator, long *counters, char (*names)[SAMPLE_NAME_SIZE]);
+
+//set sampling: only the sets whose hashed number is a multiple of setRatio are simulated
+//interval sampling: of every period records the first warmup are simulated without counting,
+//the next measure are counted and the rest are skipped without simulating them
+struct SampleConfig{
+    unsigned long setRatio;
+    unsigned long period;
+    unsigned long warmup;
+    unsigned long measure;
+};
+
+//The records every unit covered and what every counter did over it. A unit is one group of
+//sampled sets or one measured interval.
+struct SampleUnit{
+    unsigned long records;
+    long counters[SAMPLE_MAX_COUNTERS];
+};
+
+//Approximate results from a sample of the trace. Every counter is extrapolated with a ratio
+//estimator, total records * (sum over units of the counter) / (sum over units of the records),
+//and reported with the half width of its 95% confidence interval from the spread of the
+//per unit ratios. Set sampling selects sets by the index of the level with the fewest sets,
+//whose index bits every other level's index includes, so a sampled set's blocks land in
+//sampled sets of every level and whole sets are always simulated.
+struct Sampler{
+    struct SampleConfig config;
+    int numSets;
+    int blockSize;
+    //unit of every set, -1 when it isn't sampled
+    signed char *setUnits;
+    CountersFunction countersOf;
+    int numCounters;
+    char names[SAMPLE_MAX_COUNTERS][SAMPLE_NAME_SIZE];
+    unsigned long records;
+    unsigned long simulated;
+    int numUnits;
+    int unitCapacity;
+    struct SampleUnit *units;
+};
+
+bool parseIntervalSampling(const char *text, struct SampleConfig *config);
+struct Sampler *newSampler(struct SampleConfig config, int numSets, int blockSize, void *simulator, CountersFunction countersOf);
+void runSampled(struct Sampler *sampler, struct TraceReader *reader, void *simulator, SimulateFunction simulate);
+void printSampledResults(struct Sampler *sampler, FILE *out);
+void freeSampler(struct Sampler *sampler);
+
+#endif
@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include "cache.h"
+#include "stackdistance.h"
+
+static unsigned int nextPriority(void){
+    //xorshift, priorities only need to look random
+    static unsigned int state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void initTreap(struct Treap *treap){
+    treap->capacity = 1024;
+    treap->nodes = malloc(treap->capacity * sizeof(struct TreapNode));
+    //node 0 is the empty tree
+    treap->nodes[0].size = 0;
+    treap->used = 1;
+    treap->freeList = 0;
+}
+
+static int newNode(struct Treap *treap, unsigned long time){
+    int node = treap->freeList;
+    if(node != 0){
+        treap->freeList = treap->nodes[node].left;
+    }
+    else{
+        if(treap->used == treap->capacity){
+            treap->capacity *= 2;
+            treap->nodes = realloc(treap->nodes, treap->capacity * sizeof(struct TreapNode));
+        }
+        node = treap->used ++;
+    }
+    treap->nodes[node].time = time;
+    treap->nodes[node].priority = nextPriority();
+    treap->nodes[node].left = 0;
+    treap->nodes[node].right = 0;
+    treap->nodes[node].size = 1;
+    return node;
+}
+
+static void resize(struct TreapNode *nodes, int node){
+    nodes[node].size = 1 + nodes[nodes[node].left].size + nodes[nodes[node].right].size;
+}
+
+//join two trees where every time in left is earlier than every time in right
+static int merge(struct TreapNode *nodes, int left, int right){
+    if(left == 0 || right == 0){
+        return left | right;
+    }
+    if(nodes[left].priority > nodes[right].priority){
+        nodes[left].right = merge(nodes, nodes[left].right, right);
+        resize(nodes, left);
+        return left;
+    }
+    nodes[right].left = merge(nodes, left, nodes[right].left);
+    resize(nodes, right);
+    return right;
+}
+
+//add a node touched later than everything in the tree: it can only go on the right spine
+static void appendNewest(struct TreapNode *nodes, int *root, int node){
+    int *link = root;
+    while(*link != 0 && nodes[*link].priority > nodes[node].priority){
+        nodes[*link].size ++;
+        link = &nodes[*link].right;
+    }
+    nodes[node].left = *link;
+    nodes[node].right = 0;
+    resize(nodes, node);
+    *link = node;
+}
+
+//stack distance of the block last touched at oldTime, the number of blocks in the set touched
+//since, or -1 if the set no longer holds it
+static int findDistance(struct TreapNode *nodes, int node, unsigned long oldTime){
+    int distance = 0;
+    while(node != 0 && nodes[node].time != oldTime){
+        if(oldTime < nodes[node].time){
+            distance += 1 + nodes[nodes[node].right].size;
+            node = nodes[node].left;
+        }
+        else{
+            node = nodes[node].right;
+        }
+    }
+    if(node == 0){
+        return -1;
+    }
+    return distance + nodes[nodes[node].right].size;
+}
+
+//take the node for oldTime (which must be in the tree) out of it
+static int unlinkTime(struct TreapNode *nodes, int *root, unsigned long oldTime){
+    int *link = root;
+    while(nodes[*link].time != oldTime){
+        int node = *link;
+        nodes[node].size --;
+        link = oldTime < nodes[node].time ? &nodes[node].left : &nodes[node].right;
+    }
+    int node = *link;
+    *link = merge(nodes, nodes[node].left, nodes[node].right);
+    return node;
+}
+
+//take the least recently touched node out of the tree
+static int unlinkOldest(struct TreapNode *nodes, int *root){
+    int *link = root;
+    while(nodes[*link].left != 0){
+        nodes[*link].size --;
+        link = &nodes[*link].left;
+    }
+    int node = *link;
+    *link = nodes[node].right;
+    return node;
+}
+
+struct StackDistance *newStackDistance(int blockSize, int maxLevel, int maxDistance){
+    struct StackDistance *stackDistance = calloc(1, sizeof(struct StackDistance));
+    stackDistance->blockSize = blockSize;
+    stackDistance->maxLevel = maxLevel;
+    stackDistance->maxDistance = maxDistance;
+    stackDistance->lastAccess = newHashMap(1 << 16);
+    stackDistance->levels = malloc((maxLevel + 1) * sizeof(struct Treap));
+    stackDistance->roots = malloc((maxLevel + 1) * sizeof(int *));
+    stackDistance->histograms = malloc((maxLevel + 1) * sizeof(unsigned long *));
+    for(int level = 0; level <= maxLevel; level ++){
+        initTreap(&stackDistance->levels[level]);
+        stackDistance->roots[level] = calloc(1UL << level, sizeof(int));
+        stackDistance->histograms[level] = calloc(maxDistance, sizeof(unsigned long));
+    }
+    return stackDistance;
+}
+
+void freeStackDistance(struct StackDistance *stackDistance){
+    for(int level = 0; level <= stackDistance->maxLevel; level ++){
+        free(stackDistance->levels[level].nodes);
+        free(stackDistance->roots[level]);
+        free(stackDistance->histograms[level]);
+    }
+    free(stackDistance->levels);
+    free(stackDistance->roots);
+    free(stackDistance->histograms);
+    freeHashMap(stackDistance->lastAccess);
+    free(stackDistance);
+}
+
+void recordAccess(struct StackDistance *stackDistance, char memAction, unsigned long address){
+    unsigned long time = ++ stackDistance->time;
+    stackDistance->accesses ++;
+    if(memAction == 'W'){
+        stackDistance->writes ++;
+    }
+    unsigned long block = address / stackDistance->blockSize;
+    unsigned long lastTime;
+    bool seen = hashMapGet(stackDistance->lastAccess, block, &lastTime);
+    hashMapPut(stackDistance->lastAccess, block, time);
+    //the set at every smaller level is just the low bits of the set at the largest one
+    unsigned long index = computeIndex(address, 1 << stackDistance->maxLevel, stackDistance->blockSize);
+    for(int level = 0; level <= stackDistance->maxLevel; level ++){
+        struct Treap *treap = &stackDistance->levels[level];
+        int *root = &stackDistance->roots[level][index & ((1UL << level) - 1)];
+        int distance = seen ? findDistance(treap->nodes, *root, lastTime) : -1;
+        int node;
+        if(distance >= 0){
+            stackDistance->histograms[level][distance] ++;
+            node = unlinkTime(treap->nodes, root, lastTime);
+            treap->nodes[node].time = time;
+            treap->nodes[node].priority = nextPriority();
+        }
+        else{
+            node = newNode(treap, time);
+        }
+        appendNewest(treap->nodes, root, node);
+        //a block deeper than maxDistance can only miss, so the set forgets it
+        if(treap->nodes[*root].size > stackDistance->maxDistance){
+            node = unlinkOldest(treap->nodes, root);
+            treap->nodes[node].left = treap->freeList;
+            treap->freeList = node;
+        }
+    }
+}
+
+//hits an LRU cache with 2^level sets of the given associativity would have had
+unsigned long stackDistanceHits(struct StackDistance *stackDistance, int level, int associativity){
+    unsigned long hits = 0;
+    for(int distance = 0; distance < associativity && distance < stackDistance->maxDistance; distance ++){
+        hits += stackDistance->histograms[level][distance];
+    }
+    return hits;
+}
@@ -0,0 +1,50 @@
+#ifndef STACKDISTANCE_H
+#define STACKDISTANCE_H
+
+#include "hashmap.h"
+
+//Order statistics tree (a treap) per set of every level, keyed by the time each block
+//mapped to the set was last touched. A tree never holds more than maxDistance blocks:
+//anything pushed deeper than that can only miss again, so it is dropped and treated
+//like a first touch when it comes back. Trees of a level share one node pool, and a node is
+//kept in one struct so each step down a tree touches a single host cache line.
+struct TreapNode{
+    unsigned long time;
+    unsigned int priority;
+    int left;
+    int right;
+    int size;
+};
+
+struct Treap{
+    struct TreapNode *nodes;
+    int capacity;
+    int used;
+    int freeList;
+};
+
+//Single pass LRU stack distance (Mattson) analysis for every power of two number of sets
+//from 1 to 2^maxLevel at once. Level k maps blocks to 2^k sets the same way computeIndex()
+//does, and histograms[k][d] counts accesses whose stack distance within their set was d,
+//so an LRU cache with 2^k sets and associativity a hits on every access with d < a.
+//Distances of maxDistance or more (and first touches) are only counted as misses, which
+//keeps every level's trees as small as the largest cache it describes.
+struct StackDistance{
+    int blockSize;
+    int maxLevel;
+    int maxDistance;
+    unsigned long time;
+    unsigned long accesses;
+    unsigned long writes;
+    struct HashMap *lastAccess;
+    struct Treap *levels;
+    int **roots;
+    unsigned long **histograms;
+};
+
+struct StackDistance *newStackDistance(int blockSize, int maxLevel, int maxDistance);
+void freeStackDistance(struct StackDistance *stackDistance);
+void recordAccess(struct StackDistance *stackDistance, char memAction, unsigned long address);
+unsigned long stackDistanceHits(struct StackDistance *stackDistance, int level, int associativity);
+
+#endif
@@ -0,0 +1,67 @@
+#include <stdlib.h>
+#include <string.h>
+#include "stats.h"
+
+struct StatsStream *newStatsStream(const char *path, unsigned long window){
+    FILE *out = fopen(path, "w");
+    if(out == NULL){
+        return NULL;
+    }
+    struct StatsStream *stats = calloc(1, sizeof(struct StatsStream));
+    stats->out = out;
+    stats->window = window;
+    fprintf(out, "#window,window,first record,records,hits,misses,miss ratio,memreads,memwrites\n");
+    return stats;
+}
+
+//levels are added closest to the cpu first
+void addStatsLevel(struct StatsStream *stats, int numSets){
+    stats->numSets[stats->numLevels] = numSets;
+    stats->sets[stats->numLevels] = calloc(numSets, sizeof(struct SetCounters));
+    stats->numLevels ++;
+}
+
+static void writeWindow(struct StatsStream *stats, unsigned long records, struct WindowTotals now){
+    unsigned long hits = now.hits - stats->last.hits;
+    unsigned long misses = now.misses - stats->last.misses;
+    fprintf(stats->out, "window,%lu,%lu,%lu,%lu,%lu,%.6f,%lu,%lu\n", stats->windows, stats->records - records, records, hits, misses, hits + misses > 0 ? (double)misses / (hits + misses) : 0, now.memReads - stats->last.memReads, now.memWrites - stats->last.memWrites);
+    stats->windows ++;
+    stats->last = now;
+}
+
+//simulate a batch in pieces that end on window boundaries, writing a row at each one
+void simulateWindowed(struct StatsStream *stats, void *simulator, SimulateFunction simulate, TotalsFunction totals, struct TraceRecord *records, int count){
+    while(count > 0){
+        unsigned long left = stats->window - stats->records % stats->window;
+        int piece = left < (unsigned long)count ? (int)left : count;
+        simulate(simulator, records, piece);
+        stats->records += piece;
+        if(stats->records % stats->window == 0){
+            writeWindow(stats, stats->window, totals(simulator));
+        }
+        records += piece;
+        count -= piece;
+    }
+}
+
+//writes the last, partial window and the per set counters, returns false on any write error
+bool closeStatsStream(struct StatsStream *stats, void *simulator, TotalsFunction totals){
+    unsigned long partial = stats->records % stats->window;
+    if(partial > 0){
+        writeWindow(stats, partial, totals(simulator));
+    }
+    fprintf(stats->out, "#set,level,set,accesses,misses,conflicts\n");
+    for(int level = 0; level < stats->numLevels; level ++){
+        for(int set = 0; set < stats->numSets[level]; set ++){
+            struct SetCounters *counters = &stats->sets[level][set];
+            if(counters->accesses > 0){
+                fprintf(stats->out, "set,%d,%d,%lu,%lu,%lu\n", level + 1, set, counters->accesses, counters->misses, counters->conflicts);
+            }
+        }
+        free(stats->sets[level]);
+    }
+    bool ok = !ferror(stats->out);
+    ok = fclose(stats->out) == 0 && ok;
+    free(stats);
+    return ok;
+}
@@ -0,0 +1,61 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "trace.h"
+#include "sweep.h"
+
+#define STATS_MAX_LEVELS 8
+#define DEFAULT_STATS_WINDOW 1000000
+
+struct SetCounters{
+    unsigned long accesses;
+    unsigned long misses;
+    unsigned long conflicts;
+};
+
+//running totals of a simulator, each window row is the difference from the last one
+struct WindowTotals{
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long memReads;
+    unsigned long memWrites;
+};
+
+typedef struct WindowTotals (*TotalsFunction)(void *simulator);
+
+//Instrumentation written as CSV while the trace runs. Every window of records gets a row as
+//soon as it is simulated, and the per set counters of every level follow at the end (sets
+//that were never accessed are left out):
+//  window,<window>,<first record>,<records>,<hits>,<misses>,<miss ratio>,<memreads>,<memwrites>
+//  set,<level>,<set>,<accesses>,<misses>,<conflicts>
+//hits and misses are the L1's, levels count from 1, and a conflict is a fill (on a miss, of a
+//prefetch or of a victim moving down a level) that had to evict a valid block because its
+//set was full.
+struct StatsStream{
+    FILE *out;
+    unsigned long window;
+    unsigned long windows;
+    unsigned long records;
+    struct WindowTotals last;
+    int numLevels;
+    int numSets[STATS_MAX_LEVELS];
+    struct SetCounters *sets[STATS_MAX_LEVELS];
+};
+
+struct StatsStream *newStatsStream(const char *path, unsigned long window);
+void addStatsLevel(struct StatsStream *stats, int numSets);
+void simulateWindowed(struct StatsStream *stats, void *simulator, SimulateFunction simulate, TotalsFunction totals, struct TraceRecord *records, int count);
+bool closeStatsStream(struct StatsStream *stats, void *simulator, TotalsFunction totals);
+
+static inline void countSetAccess(struct StatsStream *stats, int level, unsigned long set, bool miss){
+    stats->sets[level][set].accesses ++;
+    stats->sets[level][set].misses += miss;
+}
+
+static inline void countSetConflict(struct StatsStream *stats, int level, unsigned long set){
+    stats->sets[level][set].conflicts ++;
+}
+
+#endif
@@ -0,0 +1,233 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "sweep.h"
+
+//batches in flight between the decoding thread and the workers
+#define RING_SLOTS 16
+#define RING_BATCH_SIZE (TRACE_BATCH_SIZE * 16)
+//batches a worker runs through one simulator before giving other workers a chance at it
+#define BATCHES_PER_TURN 4
+
+//when the trace is partitioned, buckets holds the batch reordered so that the records
+//for simulator i are bucketStarts[i] .. bucketStarts[i + 1]
+struct Batch{
+    struct TraceRecord *records;
+    int count;
+    struct TraceRecord *buckets;
+    int *bucketStarts;
+};
+
+//The decoding thread fills ring slots in trace order and never touches a slot again until
+//every simulator has consumed it, so workers read batches without holding the lock. Workers
+//pick whichever idle simulator is furthest behind, which spreads uneven simulators across
+//threads and keeps the oldest slot draining.
+//With a partition function every simulator only sees its own bucket of each batch instead.
+struct Sweep{
+    pthread_mutex_t lock;
+    pthread_cond_t batchReady;
+    pthread_cond_t slotFree;
+    struct Batch ring[RING_SLOTS];
+    long produced;
+    bool finished;
+    void **simulators;
+    int numSimulators;
+    SimulateFunction simulate;
+    PartitionFunction partition;
+    void *partitionContext;
+    //scratch of the decoding thread for bucketing a batch, allocated once per sweep
+    unsigned short *owners;
+    int *bucketNext;
+    long *consumed;
+    bool *busy;
+};
+
+//parse "n", "a,b,c" or a power of two range "lo-hi" into values, returns how many there are
+int parseSweepValues(char *text, int *values){
+    int count = 0;
+    char *save;
+    for(char *item = strtok_r(text, ",", &save); item != NULL && count < MAX_SWEEP_VALUES; item = strtok_r(NULL, ",", &save)){
+        char *dash = strchr(item, '-');
+        int low = atoi(item);
+        int high = dash == NULL ? low : atoi(dash + 1);
+        for(long value = low; value <= high && value > 0 && count < MAX_SWEEP_VALUES; value *= 2){
+            values[count ++] = value;
+        }
+    }
+    return count;
+}
+
+static long slowestSimulator(struct Sweep *sweep){
+    long slowest = sweep->produced;
+    for(int i = 0; i < sweep->numSimulators; i ++){
+        if(sweep->consumed[i] < slowest){
+            slowest = sweep->consumed[i];
+        }
+    }
+    return slowest;
+}
+
+static void *sweepWorker(void *argument){
+    struct Sweep *sweep = argument;
+    pthread_mutex_lock(&sweep->lock);
+    while(true){
+        int chosen = -1;
+        bool allDone = true;
+        for(int i = 0; i < sweep->numSimulators; i ++){
+            if(sweep->consumed[i] < sweep->produced){
+                allDone = false;
+                if(!sweep->busy[i] && (chosen < 0 || sweep->consumed[i] < sweep->consumed[chosen])){
+                    chosen = i;
+                }
+            }
+        }
+        if(chosen < 0){
+            if(allDone && sweep->finished){
+                break;
+            }
+            pthread_cond_wait(&sweep->batchReady, &sweep->lock);
+            continue;
+        }
+        sweep->busy[chosen] = true;
+        long first = sweep->consumed[chosen];
+        long last = sweep->produced;
+        if(last - first > BATCHES_PER_TURN){
+            last = first + BATCHES_PER_TURN;
+        }
+        pthread_mutex_unlock(&sweep->lock);
+        for(long batch = first; batch < last; batch ++){
+            struct Batch *slot = &sweep->ring[batch % RING_SLOTS];
+            if(sweep->partition != NULL){
+                int start = slot->bucketStarts[chosen];
+                sweep->simulate(sweep->simulators[chosen], &slot->buckets[start], slot->bucketStarts[chosen + 1] - start);
+            }
+            else{
+                sweep->simulate(sweep->simulators[chosen], slot->records, slot->count);
+            }
+        }
+        pthread_mutex_lock(&sweep->lock);
+        sweep->consumed[chosen] = last;
+        sweep->busy[chosen] = false;
+        //the simulator may be free for another worker and the oldest slot may be free for the decoder
+        pthread_cond_broadcast(&sweep->batchReady);
+        pthread_cond_signal(&sweep->slotFree);
+    }
+    pthread_mutex_unlock(&sweep->lock);
+    return NULL;
+}
+
+//radix sort the batch into one bucket per simulator, keeping trace order within each bucket
+static void bucketBatch(struct Sweep *sweep, struct Batch *slot){
+    int *starts = slot->bucketStarts;
+    memset(starts, 0, (sweep->numSimulators + 1) * sizeof(int));
+    for(int i = 0; i < slot->count; i ++){
+        sweep->owners[i] = sweep->partition(sweep->partitionContext, slot->records[i].address);
+        starts[sweep->owners[i] + 1] ++;
+    }
+    for(int i = 0; i < sweep->numSimulators; i ++){
+        starts[i + 1] += starts[i];
+    }
+    int *next = sweep->bucketNext;
+    memcpy(next, starts, sweep->numSimulators * sizeof(int));
+    for(int i = 0; i < slot->count; i ++){
+        slot->buckets[next[sweep->owners[i]] ++] = slot->records[i];
+    }
+}
+
+static void runRing(struct TraceReader *reader, void **simulators, int numSimulators, SimulateFunction simulate, int numThreads, PartitionFunction partition, void *partitionContext){
+    struct Sweep sweep = {0};
+    pthread_mutex_init(&sweep.lock, NULL);
+    pthread_cond_init(&sweep.batchReady, NULL);
+    pthread_cond_init(&sweep.slotFree, NULL);
+    sweep.simulators = simulators;
+    sweep.numSimulators = numSimulators;
+    sweep.simulate = simulate;
+    sweep.partition = partition;
+    sweep.partitionContext = partitionContext;
+    sweep.consumed = calloc(numSimulators, sizeof(long));
+    sweep.busy = calloc(numSimulators, sizeof(bool));
+    for(int i = 0; i < RING_SLOTS; i ++){
+        sweep.ring[i].records = malloc(RING_BATCH_SIZE * sizeof(struct TraceRecord));
+        if(partition != NULL){
+            sweep.ring[i].buckets = malloc(RING_BATCH_SIZE * sizeof(struct TraceRecord));
+            sweep.ring[i].bucketStarts = malloc((numSimulators + 1) * sizeof(int));
+        }
+    }
+    if(partition != NULL){
+        sweep.owners = malloc(RING_BATCH_SIZE * sizeof(unsigned short));
+        sweep.bucketNext = malloc(numSimulators * sizeof(int));
+    }
+    pthread_t *workers = malloc(numThreads * sizeof(pthread_t));
+    for(int i = 0; i < numThreads; i ++){
+        pthread_create(&workers[i], NULL, sweepWorker, &sweep);
+    }
+    //this thread decodes the trace into the ring
+    while(true){
+        pthread_mutex_lock(&sweep.lock);
+        while(sweep.produced - slowestSimulator(&sweep) >= RING_SLOTS){
+            pthread_cond_wait(&sweep.slotFree, &sweep.lock);
+        }
+        struct Batch *slot = &sweep.ring[sweep.produced % RING_SLOTS];
+        pthread_mutex_unlock(&sweep.lock);
+        slot->count = 0;
+        int count;
+        while(slot->count < RING_BATCH_SIZE && (count = readTraceBatch(reader, slot->records + slot->count, RING_BATCH_SIZE - slot->count)) > 0){
+            slot->count += count;
+        }
+        if(partition != NULL && slot->count > 0){
+            bucketBatch(&sweep, slot);
+        }
+        pthread_mutex_lock(&sweep.lock);
+        if(slot->count > 0){
+            sweep.produced ++;
+        }
+        else{
+            sweep.finished = true;
+        }
+        pthread_cond_broadcast(&sweep.batchReady);
+        pthread_mutex_unlock(&sweep.lock);
+        if(slot->count == 0){
+            break;
+        }
+    }
+    for(int i = 0; i < numThreads; i ++){
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    for(int i = 0; i < RING_SLOTS; i ++){
+        free(sweep.ring[i].records);
+        free(sweep.ring[i].buckets);
+        free(sweep.ring[i].bucketStarts);
+    }
+    free(sweep.owners);
+    free(sweep.bucketNext);
+    free(sweep.consumed);
+    free(sweep.busy);
+    pthread_cond_destroy(&sweep.batchReady);
+    pthread_cond_destroy(&sweep.slotFree);
+    pthread_mutex_destroy(&sweep.lock);
+}
+
+//decode each batch of the trace once and run it through every simulator,
+//on numThreads worker threads when there is more than one
+void runSweep(struct TraceReader *reader, void **simulators, int numSimulators, SimulateFunction simulate, int numThreads){
+    if(numThreads > 1 && numSimulators > 1){
+        runRing(reader, simulators, numSimulators, simulate, numThreads, NULL, NULL);
+        return;
+    }
+    struct TraceRecord records[TRACE_BATCH_SIZE];
+    int count;
+    while((count = readTraceBatch(reader, records, TRACE_BATCH_SIZE)) > 0){
+        for(int i = 0; i < numSimulators; i ++){
+            simulate(simulators[i], records, count);
+        }
+    }
+}
+
+//run one configuration split across numPartitions simulators that own disjoint parts of it,
+//one thread each; partition maps an address to the simulator that owns it
+void runPartitioned(struct TraceReader *reader, void **partitions, int numPartitions, SimulateFunction simulate, PartitionFunction partition, void *partitionContext){
+    runRing(reader, partitions, numPartitions, simulate, numPartitions, partition, partitionContext);
+}
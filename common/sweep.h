@@ -0,0 +1,17 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "trace.h"
+
+#define MAX_SWEEP_VALUES 64
+
+//advances one simulator over the next records of the trace
+typedef void (*SimulateFunction)(void *simulator, struct TraceRecord *records, int count);
+//picks which of the partitioned simulators handles an address
+typedef int (*PartitionFunction)(void *context, unsigned long address);
+
+int parseSweepValues(char *text, int *values);
+void runSweep(struct TraceReader *reader, void **simulators, int numSimulators, SimulateFunction simulate, int numThreads);
+void runPartitioned(struct TraceReader *reader, void **partitions, int numPartitions, SimulateFunction simulate, PartitionFunction partition, void *partitionContext);
+
+#endif
@@ -0,0 +1,471 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "trace.h"
+
+//streamed input is read by a background thread into two halves of this size, the parser
+//works on a buffer holding one half plus whatever partial line or chunk is left over
+#define READ_AHEAD_SIZE (1 << 22)
+#define STREAM_BUFFER_SIZE (2 * READ_AHEAD_SIZE)
+
+//Double buffering for input that can't be mapped: the reader thread fills one half with
+//read() while the parser copies the other one out, so waiting on a pipe (a decompressor, a
+//fifo) overlaps with simulating the records already read. last marks the half that ended
+//at the end of the input, and error is the errno of the read that ended it if that failed.
+struct ReadAhead{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t emptied;
+    int fd;
+    char *halves[2];
+    size_t lengths[2];
+    bool last[2];
+    bool full[2];
+    int next;
+    bool stop;
+    int error;
+};
+
+//hex digit value plus one, so zero means "not a hex digit"
+static const unsigned char hexDigit[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+static double now(void){
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+//length of the run of hex digits starting at p
+static inline int hexRun(const char *p, const char *end){
+    int length = 0;
+#ifdef __SSE2__
+    //classify 16 characters at once and find the first one that isn't a hex digit
+    if(end - p >= 16){
+        __m128i chars = _mm_loadu_si128((const __m128i *)p);
+        __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+        unsigned int mask = _mm_movemask_epi8(_mm_or_si128(digit, letter));
+        if(mask != 0xFFFF){
+            return __builtin_ctz(~mask);
+        }
+        length = 16;
+    }
+#endif
+    while(p + length < end && hexDigit[(unsigned char)p[length]]){
+        length ++;
+    }
+    return length;
+}
+
+//decode complete records from [p, end), returns where parsing stopped
+static const char *parseRecords(const char *p, const char *end, struct TraceRecord *records, int maxRecords, int *count){
+    int n = 0;
+    while(n < maxRecords){
+        //skip blank space between records
+        while(p < end && (*p == '\n' || *p == ' ' || *p == '\r' || *p == '\t')){
+            p ++;
+        }
+        if(p >= end){
+            break;
+        }
+        char memAction = *p ++;
+        while(p < end && (*p == ' ' || *p == '\t')){
+            p ++;
+        }
+        if(end - p >= 2 && p[0] == '0' && (p[1] | 0x20) == 'x'){
+            p += 2;
+        }
+        int digits = hexRun(p, end);
+        unsigned long address = 0;
+        for(int i = 0; i < digits; i ++){
+            address = (address << 4) | (unsigned long)(hexDigit[(unsigned char)p[i]] - 1);
+        }
+        p += digits;
+        //skip whatever is left of the line
+        if(p < end && *p == '\n'){
+            p ++;
+        }
+        else if(p < end){
+            const char *newline = memchr(p, '\n', end - p);
+            p = newline == NULL ? end : newline + 1;
+        }
+        //lines that aren't reads or writes (comments, "#eof" markers) are dropped, the original
+        //fscanf loop read "#eof" as accesses to 0xe and 0xf
+        if((memAction == 'R' || memAction == 'W') && digits > 0){
+            records[n].memAction = memAction;
+            records[n].address = address;
+            n ++;
+        }
+    }
+    *count = n;
+    return p;
+}
+
+//Cancellation is only enabled around read(), which can block forever on a quiet pipe, so the
+//thread is never cancelled holding the lock. A half is handed over as soon as it is full or
+//the input has nothing more ready, so a slow writer doesn't hold back records already read.
+static void *readAheadThread(void *argument){
+    struct ReadAhead *readAhead = argument;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    bool ended = false;
+    for(int half = 0; !ended; half = 1 - half){
+        pthread_mutex_lock(&readAhead->lock);
+        while(readAhead->full[half] && !readAhead->stop){
+            pthread_cond_wait(&readAhead->emptied, &readAhead->lock);
+        }
+        bool stop = readAhead->stop;
+        pthread_mutex_unlock(&readAhead->lock);
+        if(stop){
+            break;
+        }
+        size_t length = 0;
+        struct pollfd ready = {.fd = readAhead->fd, .events = POLLIN};
+        while(length < READ_AHEAD_SIZE && (length == 0 || poll(&ready, 1, 0) > 0)){
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+            ssize_t bytes = read(readAhead->fd, readAhead->halves[half] + length, READ_AHEAD_SIZE - length);
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+            if(bytes < 0 && errno == EINTR){
+                continue;
+            }
+            if(bytes <= 0){
+                readAhead->error = bytes < 0 ? errno : 0;
+                ended = true;
+                break;
+            }
+            length += bytes;
+        }
+        pthread_mutex_lock(&readAhead->lock);
+        readAhead->lengths[half] = length;
+        readAhead->last[half] = ended;
+        readAhead->full[half] = true;
+        pthread_cond_signal(&readAhead->filled);
+        pthread_mutex_unlock(&readAhead->lock);
+    }
+    return NULL;
+}
+
+static struct ReadAhead *startReadAhead(int fd){
+    struct ReadAhead *readAhead = calloc(1, sizeof(struct ReadAhead));
+    readAhead->fd = fd;
+    readAhead->halves[0] = malloc(READ_AHEAD_SIZE);
+    readAhead->halves[1] = malloc(READ_AHEAD_SIZE);
+    pthread_mutex_init(&readAhead->lock, NULL);
+    pthread_cond_init(&readAhead->filled, NULL);
+    pthread_cond_init(&readAhead->emptied, NULL);
+    pthread_create(&readAhead->thread, NULL, readAheadThread, readAhead);
+    return readAhead;
+}
+
+static void stopReadAhead(struct ReadAhead *readAhead){
+    pthread_mutex_lock(&readAhead->lock);
+    readAhead->stop = true;
+    pthread_cond_signal(&readAhead->emptied);
+    pthread_mutex_unlock(&readAhead->lock);
+    pthread_cancel(readAhead->thread);
+    pthread_join(readAhead->thread, NULL);
+    pthread_cond_destroy(&readAhead->filled);
+    pthread_cond_destroy(&readAhead->emptied);
+    pthread_mutex_destroy(&readAhead->lock);
+    free(readAhead->halves[0]);
+    free(readAhead->halves[1]);
+    free(readAhead);
+}
+
+//move the unparsed tail to the front of the buffer and append the next half read ahead
+static void refill(struct TraceReader *reader){
+    struct ReadAhead *readAhead = reader->readAhead;
+    size_t remaining = reader->size - reader->offset;
+    memmove(reader->buffer, reader->buffer + reader->offset, remaining);
+    reader->offset = 0;
+    reader->size = remaining;
+    if(reader->bufferCapacity - reader->size < READ_AHEAD_SIZE){
+        //a single line (or binary chunk) longer than the buffer, grow it
+        reader->bufferCapacity *= 2;
+        reader->buffer = realloc(reader->buffer, reader->bufferCapacity);
+        reader->data = reader->buffer;
+    }
+    int half = readAhead->next;
+    pthread_mutex_lock(&readAhead->lock);
+    while(!readAhead->full[half]){
+        pthread_cond_wait(&readAhead->filled, &readAhead->lock);
+    }
+    pthread_mutex_unlock(&readAhead->lock);
+    size_t length = readAhead->lengths[half];
+    memcpy(reader->buffer + reader->size, readAhead->halves[half], length);
+    reader->size += length;
+    if(readAhead->last[half]){
+        reader->endOfInput = true;
+        reader->error = readAhead->error;
+        return;
+    }
+    pthread_mutex_lock(&readAhead->lock);
+    readAhead->full[half] = false;
+    readAhead->next = 1 - half;
+    pthread_cond_signal(&readAhead->emptied);
+    pthread_mutex_unlock(&readAhead->lock);
+}
+
+//binary traces start with a header, anything else is parsed as text; returns false for a
+//binary trace of a version this reader can't decode
+static bool detectFormat(struct TraceReader *reader){
+    if(readTraceHeader((const unsigned char *)reader->data, reader->size, &reader->header)){
+        if(reader->header.version != TRACE_VERSION){
+            fprintf(stderr, "unsupported trace version %u, convert the text trace again\n", reader->header.version);
+            return false;
+        }
+        reader->binary = true;
+        reader->offset = TRACE_FIRST_CHUNK;
+    }
+    return true;
+}
+
+//"-" reads the trace from standard input. Returns NULL when the trace can't be opened, with
+//errno set to EPROTO for a binary trace of another version (already reported on stderr).
+struct TraceReader *openTrace(const char *path){
+    int fd = strcmp(path, "-") == 0 ? dup(STDIN_FILENO) : open(path, O_RDONLY);
+    if(fd < 0){
+        return NULL;
+    }
+    struct TraceReader *reader = calloc(1, sizeof(struct TraceReader));
+    reader->fd = fd;
+    struct stat info;
+    if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode)){
+        if(info.st_size == 0){
+            reader->mapped = true;
+            reader->endOfInput = true;
+            return reader;
+        }
+        void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED){
+            madvise(data, info.st_size, MADV_SEQUENTIAL);
+            madvise(data, info.st_size, MADV_WILLNEED);
+            reader->mapped = true;
+            reader->endOfInput = true;
+            reader->data = data;
+            reader->size = info.st_size;
+            if(!detectFormat(reader)){
+                closeTrace(reader);
+                errno = EPROTO;
+                return NULL;
+            }
+            return reader;
+        }
+    }
+    //not mappable, stream it through a buffer instead
+    reader->bufferCapacity = STREAM_BUFFER_SIZE;
+    reader->buffer = malloc(reader->bufferCapacity);
+    reader->data = reader->buffer;
+    reader->readAhead = startReadAhead(fd);
+    //a half can be handed over as soon as anything arrived, make sure the header is all here
+    //before deciding the format
+    refill(reader);
+    while(reader->size < TRACE_HEADER_SIZE && !reader->endOfInput){
+        refill(reader);
+    }
+    if(!detectFormat(reader)){
+        closeTrace(reader);
+        errno = EPROTO;
+        return NULL;
+    }
+    return reader;
+}
+
+//decode the next records of a binary trace, moving to the next chunk once one is used up
+static int readBinaryBatch(struct TraceReader *reader, struct TraceRecord *records, int maxRecords){
+    while(reader->chunk.position == reader->chunk.count){
+        if(reader->chunksRead == reader->header.chunkCount){
+            return 0;
+        }
+        const unsigned char *chunk = (const unsigned char *)reader->data + reader->offset;
+        size_t available = reader->size - reader->offset;
+        if(available < TRACE_CHUNK_HEADER_SIZE || available < chunkBytes(chunk)){
+            //the chunk isn't fully buffered yet (a truncated file ends the trace)
+            if(reader->endOfInput){
+                return 0;
+            }
+            refill(reader);
+            continue;
+        }
+        openChunk(&reader->chunk, chunk);
+        reader->offset += chunkBytes(chunk);
+        reader->chunksRead ++;
+    }
+    return decodeChunk(&reader->chunk, records, maxRecords);
+}
+
+//parse the next records of a text trace, reading more input whenever no complete line is buffered
+static int readTextBatch(struct TraceReader *reader, struct TraceRecord *records, int maxRecords){
+    int count = 0;
+    while(count == 0){
+        const char *begin = reader->data + reader->offset;
+        const char *end = reader->data + reader->size;
+        if(!reader->endOfInput){
+            //only hand complete lines to the parser while more input can arrive
+            const char *newline = memrchr(begin, '\n', end - begin);
+            if(newline == NULL){
+                refill(reader);
+                continue;
+            }
+            end = newline + 1;
+        }
+        else if(begin >= end){
+            break;
+        }
+        const char *stop = parseRecords(begin, end, records, maxRecords, &count);
+        reader->offset = stop - reader->data;
+    }
+    return count;
+}
+
+//fills records with up to maxRecords decoded records, returns 0 once the trace is exhausted
+int readTraceBatch(struct TraceReader *reader, struct TraceRecord *records, int maxRecords){
+    double start = now();
+    int count;
+    if(reader->binary){
+        count = readBinaryBatch(reader, records, maxRecords);
+    }
+    else{
+        count = readTextBatch(reader, records, maxRecords);
+    }
+    reader->records += count;
+    reader->parseSeconds += now() - start;
+    return count;
+}
+
+//Jump to the last chunk starting at or before the record count records ahead, when the whole
+//trace is mapped and its index can be read. Returns false when there is no chunk to jump over.
+static bool skipIndexed(struct TraceReader *reader, unsigned long count, unsigned long *skipped){
+    const unsigned char *data = (const unsigned char *)reader->data;
+    unsigned long offset;
+    unsigned long first;
+    if(!readIndexEntry(data, reader->size, &reader->header, reader->chunksRead, &offset, &first)){
+        return false;
+    }
+    unsigned long target = first + count;
+    unsigned long low = reader->chunksRead;
+    unsigned long high = reader->header.chunkCount - 1;
+    unsigned long jumpOffset = offset;
+    unsigned long jumpFirst = first;
+    while(low < high){
+        unsigned long middle = low + (high - low + 1) / 2;
+        unsigned long middleOffset;
+        unsigned long middleFirst;
+        if(!readIndexEntry(data, reader->size, &reader->header, middle, &middleOffset, &middleFirst)){
+            return false;
+        }
+        if(middleFirst <= target){
+            low = middle;
+            jumpOffset = middleOffset;
+            jumpFirst = middleFirst;
+        }
+        else{
+            high = middle - 1;
+        }
+    }
+    if(low == reader->chunksRead){
+        return false;
+    }
+    reader->offset = jumpOffset;
+    reader->chunksRead = low;
+    *skipped += jumpFirst - first;
+    return true;
+}
+
+//move past the next count records without returning them, returns how many were skipped (fewer
+//only when the trace ends first). Whole binary chunks are jumped over through the index when
+//the trace is mapped, or stepped over by their header counts when it is streamed, without
+//decoding them.
+unsigned long skipTraceRecords(struct TraceReader *reader, unsigned long count){
+    struct TraceRecord discard[TRACE_BATCH_SIZE];
+    unsigned long skipped = 0;
+    while(skipped < count){
+        if(reader->binary && reader->mapped && reader->chunk.position == reader->chunk.count && skipIndexed(reader, count - skipped, &skipped)){
+            continue;
+        }
+        if(reader->binary && reader->chunk.position == reader->chunk.count && reader->chunksRead < reader->header.chunkCount){
+            const unsigned char *chunk = (const unsigned char *)reader->data + reader->offset;
+            size_t available = reader->size - reader->offset;
+            if(available >= TRACE_CHUNK_HEADER_SIZE && available >= chunkBytes(chunk)){
+                unsigned long records = chunkRecords(chunk);
+                if(records <= count - skipped){
+                    reader->offset += chunkBytes(chunk);
+                    reader->chunksRead ++;
+                    skipped += records;
+                    continue;
+                }
+            }
+        }
+        unsigned long left = count - skipped;
+        int batch = readTraceBatch(reader, discard, left < TRACE_BATCH_SIZE ? (int)left : TRACE_BATCH_SIZE);
+        if(batch == 0){
+            break;
+        }
+        skipped += batch;
+    }
+    return skipped;
+}
+
+//FNV-1a over the records, to tell traces apart
+unsigned long hashTraceRecords(const struct TraceRecord *records, int count){
+    unsigned long hash = 0xCBF29CE484222325UL;
+    for(int i = 0; i < count; i ++){
+        hash = (hash ^ records[i].address) * 0x100000001B3UL;
+        hash = (hash ^ (unsigned char)records[i].memAction) * 0x100000001B3UL;
+    }
+    return hash;
+}
+
+//what the simulators do when openTrace() fails: a missing trace keeps the original "error"
+//output and exit status, an unsupported binary trace fails the run
+//after the trace was read, reports a read error that ended it early (the records before it
+//were simulated, but the results would look like those of a whole trace)
+bool traceReadFailed(struct TraceReader *reader){
+    if(reader->error == 0){
+        return false;
+    }
+    fprintf(stderr, "error reading the trace: %s\n", strerror(reader->error));
+    return true;
+}
+
+int traceOpenFailure(void){
+    if(errno == EPROTO){
+        return EXIT_FAILURE;
+    }
+    printf("error");
+    return EXIT_SUCCESS;
+}
+
+void printTraceStats(struct TraceReader *reader, FILE *out){
+    double rate = reader->parseSeconds > 0 ? reader->records / reader->parseSeconds : 0;
+    fprintf(out, "trace: %lu records in %.3f s (%.0f records/sec)\n", reader->records, reader->parseSeconds, rate);
+}
+
+void closeTrace(struct TraceReader *reader){
+    if(reader->mapped && reader->size > 0){
+        munmap((void *)reader->data, reader->size);
+    }
+    if(reader->readAhead != NULL){
+        stopReadAhead(reader->readAhead);
+    }
+    free(reader->buffer);
+    close(reader->fd);
+    free(reader);
+}
@@ -0,0 +1,50 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "tracebin.h"
+
+#define TRACE_BATCH_SIZE 4096
+
+struct TraceRecord{
+    char memAction;
+    unsigned long address;
+};
+
+struct ReadAhead;
+
+//Reads "R 0x..." / "W 0x..." text traces and binary traces (see tracebin.h), mapping
+//regular files into memory and streaming anything that can't be mapped (stdin, pipes,
+//fifos, character devices) through a read ahead thread
+struct TraceReader{
+    int fd;
+    bool mapped;
+    bool endOfInput;
+    bool binary;
+    struct TraceHeader header;
+    struct ChunkCursor chunk;
+    unsigned long chunksRead;
+    const char *data;
+    size_t size;
+    size_t offset;
+    char *buffer;
+    size_t bufferCapacity;
+    struct ReadAhead *readAhead;
+    unsigned long records;
+    double parseSeconds;
+    //errno of a failed read of streamed input, 0 when it ended normally
+    int error;
+};
+
+struct TraceReader *openTrace(const char *path);
+int readTraceBatch(struct TraceReader *reader, struct TraceRecord *records, int maxRecords);
+unsigned long skipTraceRecords(struct TraceReader *reader, unsigned long count);
+unsigned long hashTraceRecords(const struct TraceRecord *records, int count);
+bool traceReadFailed(struct TraceReader *reader);
+int traceOpenFailure(void);
+void printTraceStats(struct TraceReader *reader, FILE *out);
+void closeTrace(struct TraceReader *reader);
+
+#endif
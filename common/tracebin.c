@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+#include "tracebin.h"
+
+static unsigned long getLittle(const unsigned char *bytes, int width){
+    unsigned long value = 0;
+    for(int i = width - 1; i >= 0; i --){
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static void putLittle(unsigned char *bytes, unsigned long value, int width){
+    for(int i = 0; i < width; i ++){
+        bytes[i] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+//true when data starts with a binary trace header, of any version
+bool readTraceHeader(const unsigned char *data, size_t size, struct TraceHeader *header){
+    if(size < TRACE_HEADER_SIZE || memcmp(data, TRACE_MAGIC, 4) != 0){
+        return false;
+    }
+    header->version = getLittle(&data[4], 2);
+    header->flags = getLittle(&data[6], 2);
+    header->recordCount = getLittle(&data[8], 8);
+    header->chunkCount = getLittle(&data[16], 8);
+    header->indexOffset = getLittle(&data[24], 8);
+    return true;
+}
+
+static size_t chunkAlign(size_t bytes){
+    return (bytes + TRACE_CHUNK_ALIGN - 1) / TRACE_CHUNK_ALIGN * TRACE_CHUNK_ALIGN;
+}
+
+//total size of the chunk starting here, header and padding included
+size_t chunkBytes(const unsigned char *chunk){
+    return chunkAlign(TRACE_CHUNK_HEADER_SIZE + getLittle(&chunk[4], 4));
+}
+
+//entry chunk of the index of a whole trace in data, false when the index isn't all there
+bool readIndexEntry(const unsigned char *data, size_t size, const struct TraceHeader *header, unsigned long chunk, unsigned long *offset, unsigned long *firstRecord){
+    if(header->indexOffset > size || (size - header->indexOffset) / TRACE_INDEX_ENTRY_SIZE < header->chunkCount || chunk >= header->chunkCount){
+        return false;
+    }
+    const unsigned char *entry = data + header->indexOffset + chunk * TRACE_INDEX_ENTRY_SIZE;
+    *offset = getLittle(entry, 8);
+    *firstRecord = getLittle(&entry[8], 8);
+    return *offset < header->indexOffset;
+}
+
+unsigned long chunkRecords(const unsigned char *chunk){
+    return getLittle(chunk, 4);
+}
+
+void openChunk(struct ChunkCursor *cursor, const unsigned char *chunk){
+    cursor->count = getLittle(chunk, 4);
+    cursor->position = 0;
+    cursor->previous = 0;
+    cursor->opBits = chunk + TRACE_CHUNK_HEADER_SIZE;
+    cursor->next = cursor->opBits + (cursor->count + 7) / 8;
+    cursor->end = cursor->opBits + getLittle(&chunk[4], 4);
+}
+
+//decode up to maxRecords records from the chunk, returns how many were decoded
+int decodeChunk(struct ChunkCursor *cursor, struct TraceRecord *records, int maxRecords){
+    int n = 0;
+    const unsigned char *next = cursor->next;
+    unsigned long previous = cursor->previous;
+    while(n < maxRecords && cursor->position < cursor->count && next < cursor->end){
+        unsigned long value = 0;
+        int shift = 0;
+        unsigned char byte;
+        do{
+            byte = *next ++;
+            value |= (unsigned long)(byte & 0x7F) << shift;
+            shift += 7;
+        }while((byte & 0x80) && next < cursor->end);
+        //undo the zigzag mapping to get the signed delta back
+        previous += (value >> 1) ^ -(value & 1);
+        unsigned int position = cursor->position ++;
+        records[n].memAction = (cursor->opBits[position >> 3] >> (position & 7)) & 1 ? 'W' : 'R';
+        records[n].address = previous;
+        n ++;
+    }
+    cursor->next = next;
+    cursor->previous = previous;
+    return n;
+}
+
+static void writeHeader(struct TraceWriter *writer){
+    unsigned char bytes[TRACE_HEADER_SIZE];
+    memcpy(bytes, TRACE_MAGIC, 4);
+    putLittle(&bytes[4], writer->header.version, 2);
+    putLittle(&bytes[6], writer->header.flags, 2);
+    putLittle(&bytes[8], writer->header.recordCount, 8);
+    putLittle(&bytes[16], writer->header.chunkCount, 8);
+    putLittle(&bytes[24], writer->header.indexOffset, 8);
+    fwrite(bytes, 1, TRACE_HEADER_SIZE, writer->file);
+}
+
+struct TraceWriter *createTraceWriter(const char *path){
+    FILE *file = fopen(path, "wb");
+    if(file == NULL){
+        return NULL;
+    }
+    struct TraceWriter *writer = calloc(1, sizeof(struct TraceWriter));
+    writer->file = file;
+    writer->header.version = TRACE_VERSION;
+    writer->header.flags = TRACE_FLAG_DELTA;
+    writer->pending = malloc(TRACE_CHUNK_RECORDS * sizeof(struct TraceRecord));
+    //worst case is ten varint bytes per record plus the op bits and the padding
+    writer->payload = malloc(TRACE_CHUNK_HEADER_SIZE + TRACE_CHUNK_RECORDS / 8 + TRACE_CHUNK_RECORDS * 10 + TRACE_CHUNK_ALIGN);
+    writer->chunkCapacity = 64;
+    writer->chunkOffsets = malloc(writer->chunkCapacity * sizeof(unsigned long));
+    //placeholder header, rewritten with the final counts on close
+    writeHeader(writer);
+    static const unsigned char padding[TRACE_CHUNK_ALIGN];
+    fwrite(padding, 1, TRACE_FIRST_CHUNK - TRACE_HEADER_SIZE, file);
+    writer->bytesWritten = TRACE_FIRST_CHUNK;
+    return writer;
+}
+
+static void flushChunk(struct TraceWriter *writer){
+    int count = writer->pendingCount;
+    if(count == 0){
+        return;
+    }
+    unsigned char *opBits = writer->payload + TRACE_CHUNK_HEADER_SIZE;
+    unsigned char *next = opBits + (count + 7) / 8;
+    memset(opBits, 0, (count + 7) / 8);
+    unsigned long previous = 0;
+    for(int i = 0; i < count; i ++){
+        if(writer->pending[i].memAction == 'W'){
+            opBits[i >> 3] |= 1 << (i & 7);
+        }
+        long delta = (long)(writer->pending[i].address - previous);
+        unsigned long value = ((unsigned long)delta << 1) ^ (unsigned long)(delta >> 63);
+        while(value >= 0x80){
+            *next ++ = (value & 0x7F) | 0x80;
+            value >>= 7;
+        }
+        *next ++ = value;
+        previous = writer->pending[i].address;
+    }
+    size_t payloadBytes = next - opBits;
+    putLittle(writer->payload, count, 4);
+    putLittle(&writer->payload[4], payloadBytes, 4);
+    if(writer->header.chunkCount == writer->chunkCapacity){
+        writer->chunkCapacity *= 2;
+        writer->chunkOffsets = realloc(writer->chunkOffsets, writer->chunkCapacity * sizeof(unsigned long));
+    }
+    writer->chunkOffsets[writer->header.chunkCount ++] = writer->bytesWritten;
+    size_t bytes = chunkAlign(TRACE_CHUNK_HEADER_SIZE + payloadBytes);
+    memset(next, 0, bytes - TRACE_CHUNK_HEADER_SIZE - payloadBytes);
+    fwrite(writer->payload, 1, bytes, writer->file);
+    writer->bytesWritten += bytes;
+    writer->header.recordCount += count;
+    writer->pendingCount = 0;
+}
+
+void writeTraceRecords(struct TraceWriter *writer, const struct TraceRecord *records, int count){
+    for(int i = 0; i < count; i ++){
+        writer->pending[writer->pendingCount ++] = records[i];
+        if(writer->pendingCount == TRACE_CHUNK_RECORDS){
+            flushChunk(writer);
+        }
+    }
+}
+
+//writes the last chunk, the chunk index and the final header, returns false on any write error
+bool closeTraceWriter(struct TraceWriter *writer){
+    flushChunk(writer);
+    writer->header.indexOffset = writer->bytesWritten;
+    unsigned char entry[TRACE_INDEX_ENTRY_SIZE];
+    for(unsigned long i = 0; i < writer->header.chunkCount; i ++){
+        putLittle(entry, writer->chunkOffsets[i], 8);
+        putLittle(&entry[8], i * TRACE_CHUNK_RECORDS, 8);
+        fwrite(entry, 1, TRACE_INDEX_ENTRY_SIZE, writer->file);
+    }
+    writer->bytesWritten += writer->header.chunkCount * TRACE_INDEX_ENTRY_SIZE;
+    rewind(writer->file);
+    writeHeader(writer);
+    bool ok = !ferror(writer->file);
+    ok = fclose(writer->file) == 0 && ok;
+    free(writer->pending);
+    free(writer->payload);
+    free(writer->chunkOffsets);
+    free(writer);
+    return ok;
+}
@@ -0,0 +1,70 @@
+#ifndef TRACEBIN_H
+#define TRACEBIN_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//Binary trace layout (all integers little endian):
+//  header   "CTRB", u16 version, u16 flags, u64 record count, u64 chunk count, u64 index offset
+//  chunks   u32 record count, u32 payload bytes, then the payload: one op bit per record
+//           (set for writes) followed by one zigzag varint per record holding the
+//           difference from the previous address in the chunk
+//  index    u64 file offset and u64 first record number of every chunk
+//Each chunk starts its deltas from address 0 so chunks decode independently. The header and
+//every chunk are zero padded to a multiple of TRACE_CHUNK_ALIGN bytes, so chunks and the index
+//start on cache line boundaries, and a reader that has the whole file can jump to any record
+//through the index instead of walking the chunk headers.
+#define TRACE_MAGIC "CTRB"
+#define TRACE_VERSION 2
+#define TRACE_FLAG_DELTA 1
+#define TRACE_HEADER_SIZE 32
+#define TRACE_CHUNK_HEADER_SIZE 8
+#define TRACE_INDEX_ENTRY_SIZE 16
+#define TRACE_CHUNK_ALIGN 64
+//the padded header, where the first chunk starts
+#define TRACE_FIRST_CHUNK ((TRACE_HEADER_SIZE + TRACE_CHUNK_ALIGN - 1) / TRACE_CHUNK_ALIGN * TRACE_CHUNK_ALIGN)
+#define TRACE_CHUNK_RECORDS 65536
+
+struct TraceRecord;
+
+struct TraceHeader{
+    unsigned short version;
+    unsigned short flags;
+    unsigned long recordCount;
+    unsigned long chunkCount;
+    unsigned long indexOffset;
+};
+
+struct ChunkCursor{
+    const unsigned char *opBits;
+    const unsigned char *next;
+    const unsigned char *end;
+    unsigned int position;
+    unsigned int count;
+    unsigned long previous;
+};
+
+struct TraceWriter{
+    FILE *file;
+    struct TraceHeader header;
+    struct TraceRecord *pending;
+    int pendingCount;
+    unsigned char *payload;
+    unsigned long *chunkOffsets;
+    unsigned long chunkCapacity;
+    unsigned long bytesWritten;
+};
+
+bool readTraceHeader(const unsigned char *data, size_t size, struct TraceHeader *header);
+size_t chunkBytes(const unsigned char *chunk);
+unsigned long chunkRecords(const unsigned char *chunk);
+bool readIndexEntry(const unsigned char *data, size_t size, const struct TraceHeader *header, unsigned long chunk, unsigned long *offset, unsigned long *firstRecord);
+void openChunk(struct ChunkCursor *cursor, const unsigned char *chunk);
+int decodeChunk(struct ChunkCursor *cursor, struct TraceRecord *records, int maxRecords);
+
+struct TraceWriter *createTraceWriter(const char *path);
+void writeTraceRecords(struct TraceWriter *writer, const struct TraceRecord *records, int count);
+bool closeTraceWriter(struct TraceWriter *writer);
+
+#endif
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "trace.h"
+#include "tracebin.h"
+
+//converts a text trace ("R 0x..." lines) into the compact binary trace format read by first and second
+int main(int argc, char* argv[argc + 1]){
+    if(argc != 3){
+        fprintf(stderr, "usage: %s <text trace> <binary trace>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    struct TraceReader *reader = openTrace(argv[1]);
+    if(reader == NULL){
+        traceOpenFailure();
+        return EXIT_FAILURE;
+    }
+    struct TraceWriter *writer = createTraceWriter(argv[2]);
+    if(writer == NULL){
+        printf("error");
+        closeTrace(reader);
+        return EXIT_FAILURE;
+    }
+    struct TraceRecord records[TRACE_BATCH_SIZE];
+    int count;
+    while((count = readTraceBatch(reader, records, TRACE_BATCH_SIZE)) > 0){
+        writeTraceRecords(writer, records, count);
+    }
+    unsigned long recordCount = reader->records;
+    bool readFailed = traceReadFailed(reader);
+    closeTrace(reader);
+    bool written = closeTraceWriter(writer);
+    if(readFailed){
+        return EXIT_FAILURE;
+    }
+    if(!written){
+        printf("error");
+        return EXIT_FAILURE;
+    }
+    struct stat input;
+    struct stat output;
+    if(stat(argv[1], &input) == 0 && stat(argv[2], &output) == 0 && S_ISREG(input.st_mode) && output.st_size > 0){
+        printf("records:%lu\ninputbytes:%ld\noutputbytes:%ld\nratio:%.2f\n", recordCount, (long)input.st_size, (long)output.st_size, (double)input.st_size / output.st_size);
+    }
+    else{
+        printf("records:%lu\n", recordCount);
+    }
+    return EXIT_SUCCESS;
+}
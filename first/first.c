@@ -1,142 +1,160 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
 #include <stdbool.h>
+#include <time.h>
+#include "cache.h"
+#include "trace.h"
+#include "sweep.h"
+#include "stackdistance.h"
+#include "prefetch.h"
+#include "stats.h"
+#include "missclass.h"
+#include "sampling.h"
 
-struct Cache{
-    int numSets;
-    struct Set **setArray;
-};
+#define MAX_PARTITIONS 256
+#define KERNEL_BENCH_CACHE_SIZE 32768
+#define KERNEL_BENCH_BLOCK_SIZE 64
+#define KERNEL_BENCH_MAX_RECORDS (16L << 20)
 
-struct Set{
-    unsigned long index;
-    int numBlocks;
-    struct Block **blockArray;
-};
+struct Simulator;
+
+typedef void (*Kernel)(struct Simulator *simulator, struct TraceRecord *records, int count);
 
-struct Block{
-    int valid;
-    unsigned long tag;
+struct Simulator{
+    int cacheSize;
+    int associativity;
     int blockSize;
-    int age;
+    int numSets;
+    char replacementPolicy[16];
+    enum ReplacementPolicy policy;
+    Kernel kernel;
+    struct WritePolicy writes;
+    struct Prefetcher *prefetcher;
+    struct StatsStream *stats;
+    struct MissClassifier *classifier;
+    struct Cache *cache;
+    long memReads;
+    long memWrites;
+    long cacheHits;
+    long cacheMisses;
+    long dirtyEvictions;
 };
 
-struct Cache *newCache(int numSets, int associativity, int blockSize){
-    unsigned long index = 0;
-    struct Cache *cache = malloc(sizeof(struct Cache));
-    cache->numSets = numSets;
-    cache->setArray = malloc(numSets * sizeof(struct Set));
-    for(int i = 0; i < numSets; i ++){
-        cache->setArray[i] = malloc(sizeof(struct Set));
-        cache->setArray[i]->index = index;
-        cache->setArray[i]->numBlocks = associativity;
-        cache->setArray[i]->blockArray = malloc(associativity * sizeof(struct Block));
-        index ++;
-        for(int j = 0; j < associativity; j ++){
-            cache->setArray[i]->blockArray[j] = malloc(sizeof(struct Block));
-            cache->setArray[i]->blockArray[j]->valid = 0;
-            cache->setArray[i]->blockArray[j]->tag = 0;
-            cache->setArray[i]->blockArray[j]->blockSize = blockSize;
-            cache->setArray[i]->blockArray[j]->age = -1;
-        }
-    }
-    return cache;
-}
-
-void freeCache(struct Cache *cache){
-    for(int i = 0; i < cache->numSets; i ++){
-        for(int j = 0; j < cache->setArray[i]->numBlocks; j ++){
-            free(cache->setArray[i]->blockArray[j]);
-        }
-        free(cache->setArray[i]->blockArray);
-        free(cache->setArray[i]);
-    }
-    free(cache->setArray);
-    free(cache);
-}
-
-unsigned long computeIndex(unsigned long address, int numSets, int blockSize){
-    unsigned long b = log2l(blockSize);
-    return ((address >> b) & (numSets - 1));
-}
-
-unsigned long computeTag(unsigned long address, int numSets, int blockSize){
-    unsigned long b = log2l(blockSize);
-    unsigned long n = log2l(numSets);
-    return (address >> (b + n));
-}
-
-void cacheSimulator(FILE *file, struct Cache *cache, int associativity, int blockSize, int numSets, char *replacementPolicy){
-    int age = 0;
-    int memReads = 0;
-    int memWrites = 0;
-    int cacheHits = 0;
-    int cacheMisses = 0;
-    char memAction;
-    unsigned long address;
-    unsigned long index;
-    unsigned long tag;
-    bool cacheHit;
-    bool spaceAvailable;
-    while(fscanf(file, "%c %lx %*[\n]", &memAction, &address) != EOF){
-        cacheHit = false;
-        spaceAvailable = false;
-        index = computeIndex(address, numSets, blockSize);
-        tag = computeTag(address, numSets, blockSize);
-        for(int i = 0; i < associativity; i ++){
-            //Check for valid blocks with same tag
-            if(cache->setArray[index]->blockArray[i]->tag == tag && cache->setArray[index]->blockArray[i]->valid == 1){
-                cacheHit = true;
-                cacheHits ++;
-                //update age if lru
-                if(strcmp(replacementPolicy, "lru") == 0){
-                    cache->setArray[index]->blockArray[i]->age = age;
+//train the prefetcher on a demand access and bring in the blocks it asks for that aren't cached
+static void runPrefetcher(struct Simulator *simulator, unsigned long address, long *memReads, long *memWrites, long *dirtyEvictions){
+    struct Cache *cache = simulator->cache;
+    struct Prefetcher *prefetcher = simulator->prefetcher;
+    unsigned long blocks[MAX_PREFETCH_DEGREE];
+    int count = prefetchCandidates(prefetcher, address, blocks);
+    for(int i = 0; i < count; i ++){
+        unsigned long index = cacheIndex(cache, blocks[i]);
+        unsigned long tag = cacheTag(cache, blocks[i]);
+        if(findBlock(cache, index, tag) >= 0){
+            continue;
+        }
+        unsigned long evictedAddress;
+        int evicted = fillBlock(cache, index, tag, false, &evictedAddress);
+        if(evicted != 0){
+            notePrefetchEviction(prefetcher, evictedAddress);
+        }
+        if(evicted != 0 && simulator->stats != NULL){
+            countSetConflict(simulator->stats, 0, index);
+        }
+        if(evicted & EVICTED_DIRTY){
+            (*dirtyEvictions) ++;
+            (*memWrites) ++;
+        }
+        (*memReads) ++;
+        notePrefetch(prefetcher, blocks[i], true);
+    }
+}
+
+//The per record loop, written once and stamped out per (policy, associativity) below. With
+//ways and policy as compile time constants the way scans unroll and the policy checks fold
+//away; ways == 0 is the generic path for any associativity. Only the generic path follows
+//simulator->writes, simulator->prefetcher, simulator->stats and simulator->classifier
+//(fullModel), the rest assume write through with write allocate, no prefetching and no
+//instrumentation.
+static inline __attribute__((always_inline)) void runKernel(struct Simulator *simulator, struct TraceRecord *records, int count, const int ways, const enum ReplacementPolicy policy, const bool fullModel){
+    struct Cache *cache = simulator->cache;
+    bool writeBack = fullModel && simulator->writes.writeBack;
+    bool writeAround = fullModel && !simulator->writes.writeAllocate;
+    struct Prefetcher *prefetcher = fullModel ? simulator->prefetcher : NULL;
+    struct StatsStream *stats = fullModel ? simulator->stats : NULL;
+    struct MissClassifier *classifier = fullModel ? simulator->classifier : NULL;
+    long memReads = simulator->memReads;
+    long memWrites = simulator->memWrites;
+    long cacheHits = simulator->cacheHits;
+    long cacheMisses = simulator->cacheMisses;
+    long dirtyEvictions = simulator->dirtyEvictions;
+    for(int r = 0; r < count; r ++){
+        char memAction = records[r].memAction;
+        unsigned long address = records[r].address;
+        unsigned long index = cacheIndex(cache, address);
+        unsigned long tag = cacheTag(cache, address);
+        if(prefetcher != NULL){
+            prefetcher->time ++;
+        }
+        //Check for valid blocks with same tag
+        int way = ways > 0 ? findWay(cache, index, tag, ways) : findBlock(cache, index, tag);
+        if(stats != NULL){
+            countSetAccess(stats, 0, index, way < 0);
+        }
+        if(classifier != NULL){
+            classifyAccess(classifier, address >> cache->offsetBits, way < 0);
+        }
+        if(way >= 0){
+            cacheHits ++;
+            //update recency if the policy tracks hits
+            if(ways > 0){
+                touchWay(&cache->replacement, index, way, ways, policy);
+            }
+            else{
+                touchBlock(cache, index, way);
+            }
+            //update memwrites if applicable, a write back cache only dirties the block
+            if(memAction == 'W'){
+                if(writeBack){
+                    setDirty(cache, index * simulator->associativity + way);
                 }
-                //update memwrites if applicable
-                if(memAction == 'W'){
+                else{
                     memWrites ++;
                 }
-                break;
             }
+            //the first use of a prefetched block keeps the prefetcher going
+            if(prefetcher != NULL && notePrefetchHit(prefetcher, address)){
+                runPrefetcher(simulator, address, &memReads, &memWrites, &dirtyEvictions);
+            }
+            continue;
         }
-        //if cache miss
-        if(!cacheHit){
+        //a write miss that doesn't allocate goes straight to memory
+        if(writeAround && memAction == 'W'){
             cacheMisses ++;
-            for(int i = 0; i < associativity; i ++){
-                //check for first invalid block to put new block in
-                if(cache->setArray[index]->blockArray[i]->valid == 0){
-                    spaceAvailable = true;
-                    cache->setArray[index]->blockArray[i]->valid = 1;
-                    cache->setArray[index]->blockArray[i]->tag = tag;
-                    cache->setArray[index]->blockArray[i]->age = age;
-                    break;
-                }
+            memWrites ++;
+        }
+        //if cache miss, fill the first invalid block or replace the policy's victim
+        else{
+            cacheMisses ++;
+            if(ways > 0){
+                fillWay(cache, index, tag, ways, policy);
             }
-            //if all blocks are valid then it is a collision
-            if(!spaceAvailable){
-                int tempIndex = 0;
-                int tempAge = cache->setArray[index]->blockArray[0]->age;
-                for(int i = 1; i < associativity; i ++){
-                    //find index of block with lowest age
-                    if(cache->setArray[index]->blockArray[i]->age < cache->setArray[index]->blockArray[i-1]->age){
-                        if(cache->setArray[index]->blockArray[i]->age < tempAge){
-                            tempAge = cache->setArray[index]->blockArray[i]->age;
-                            tempIndex = i;
-                        }
-                    }
-                    else{
-                        if(cache->setArray[index]->blockArray[i - 1]->age < tempAge){
-                            tempAge = cache->setArray[index]->blockArray[i - 1]->age;
-                            tempIndex = i - 1;
-                        }
-                    }
+            else{
+                unsigned long evictedAddress;
+                int evicted = fillBlock(cache, index, tag, writeBack && memAction == 'W', &evictedAddress);
+                if(evicted & EVICTED_DIRTY){
+                    dirtyEvictions ++;
+                    memWrites ++;
+                }
+                if(prefetcher != NULL && evicted != 0){
+                    notePrefetchEviction(prefetcher, evictedAddress);
+                }
+                if(stats != NULL && evicted != 0){
+                    countSetConflict(stats, 0, index);
                 }
-                //replace the block with the lowest age and update age
-                cache->setArray[index]->blockArray[tempIndex]->tag = tag;
-                cache->setArray[index]->blockArray[tempIndex]->age = age;
             }
-            if(memAction == 'R'){
+            if(memAction == 'R' || writeBack){
                 memReads ++;
             }
             else{
@@ -144,30 +162,690 @@ void cacheSimulator(FILE *file, struct Cache *cache, int associativity, int bloc
                 memWrites ++;
             }
         }
-        age ++;
+        if(prefetcher != NULL){
+            runPrefetcher(simulator, address, &memReads, &memWrites, &dirtyEvictions);
+        }
+    }
+    simulator->memReads = memReads;
+    simulator->memWrites = memWrites;
+    simulator->cacheHits = cacheHits;
+    simulator->cacheMisses = cacheMisses;
+    simulator->dirtyEvictions = dirtyEvictions;
+}
+
+#define DEFINE_KERNEL(name, ways, policy) \
+    static void name(struct Simulator *simulator, struct TraceRecord *records, int count){ \
+        runKernel(simulator, records, count, ways, policy, false); \
+    }
+
+DEFINE_KERNEL(fifoGeneric, 0, POLICY_FIFO)
+DEFINE_KERNEL(fifo1, 1, POLICY_FIFO)
+DEFINE_KERNEL(fifo2, 2, POLICY_FIFO)
+DEFINE_KERNEL(fifo4, 4, POLICY_FIFO)
+DEFINE_KERNEL(fifo8, 8, POLICY_FIFO)
+DEFINE_KERNEL(fifo16, 16, POLICY_FIFO)
+DEFINE_KERNEL(lruGeneric, 0, POLICY_LRU)
+DEFINE_KERNEL(lru1, 1, POLICY_LRU)
+DEFINE_KERNEL(lru2, 2, POLICY_LRU)
+DEFINE_KERNEL(lru4, 4, POLICY_LRU)
+DEFINE_KERNEL(lru8, 8, POLICY_LRU)
+DEFINE_KERNEL(lru16, 16, POLICY_LRU)
+DEFINE_KERNEL(plruGeneric, 0, POLICY_PLRU)
+DEFINE_KERNEL(plru1, 1, POLICY_PLRU)
+DEFINE_KERNEL(plru2, 2, POLICY_PLRU)
+DEFINE_KERNEL(plru4, 4, POLICY_PLRU)
+DEFINE_KERNEL(plru8, 8, POLICY_PLRU)
+DEFINE_KERNEL(plru16, 16, POLICY_PLRU)
+DEFINE_KERNEL(srripGeneric, 0, POLICY_SRRIP)
+DEFINE_KERNEL(srrip1, 1, POLICY_SRRIP)
+DEFINE_KERNEL(srrip2, 2, POLICY_SRRIP)
+DEFINE_KERNEL(srrip4, 4, POLICY_SRRIP)
+DEFINE_KERNEL(srrip8, 8, POLICY_SRRIP)
+DEFINE_KERNEL(srrip16, 16, POLICY_SRRIP)
+DEFINE_KERNEL(brripGeneric, 0, POLICY_BRRIP)
+DEFINE_KERNEL(brrip1, 1, POLICY_BRRIP)
+DEFINE_KERNEL(brrip2, 2, POLICY_BRRIP)
+DEFINE_KERNEL(brrip4, 4, POLICY_BRRIP)
+DEFINE_KERNEL(brrip8, 8, POLICY_BRRIP)
+DEFINE_KERNEL(brrip16, 16, POLICY_BRRIP)
+DEFINE_KERNEL(randomGeneric, 0, POLICY_RANDOM)
+DEFINE_KERNEL(random1, 1, POLICY_RANDOM)
+DEFINE_KERNEL(random2, 2, POLICY_RANDOM)
+DEFINE_KERNEL(random4, 4, POLICY_RANDOM)
+DEFINE_KERNEL(random8, 8, POLICY_RANDOM)
+DEFINE_KERNEL(random16, 16, POLICY_RANDOM)
+DEFINE_KERNEL(lfuGeneric, 0, POLICY_LFU)
+DEFINE_KERNEL(lfu1, 1, POLICY_LFU)
+DEFINE_KERNEL(lfu2, 2, POLICY_LFU)
+DEFINE_KERNEL(lfu4, 4, POLICY_LFU)
+DEFINE_KERNEL(lfu8, 8, POLICY_LFU)
+DEFINE_KERNEL(lfu16, 16, POLICY_LFU)
+
+//any policy and associativity with a write back and/or no write allocate cache, a prefetcher,
+//instrumentation or miss classification, the generic path takes its policy from the cache
+static void fullModelGeneric(struct Simulator *simulator, struct TraceRecord *records, int count){
+    runKernel(simulator, records, count, 0, POLICY_FIFO, true);
+}
+
+//specialized kernels by policy and log2 of the associativity, generic last
+#define NUM_KERNELS 5
+static const Kernel kernels[NUM_POLICIES][NUM_KERNELS + 1] = {
+    [POLICY_FIFO] = {fifo1, fifo2, fifo4, fifo8, fifo16, fifoGeneric},
+    [POLICY_LRU] = {lru1, lru2, lru4, lru8, lru16, lruGeneric},
+    [POLICY_PLRU] = {plru1, plru2, plru4, plru8, plru16, plruGeneric},
+    [POLICY_SRRIP] = {srrip1, srrip2, srrip4, srrip8, srrip16, srripGeneric},
+    [POLICY_BRRIP] = {brrip1, brrip2, brrip4, brrip8, brrip16, brripGeneric},
+    [POLICY_RANDOM] = {random1, random2, random4, random8, random16, randomGeneric},
+    [POLICY_LFU] = {lfu1, lfu2, lfu4, lfu8, lfu16, lfuGeneric},
+};
+
+Kernel selectKernel(int associativity, enum ReplacementPolicy policy){
+    for(int i = 0; i < NUM_KERNELS; i ++){
+        if(associativity == 1 << i){
+            return kernels[policy][i];
+        }
+    }
+    return kernels[policy][NUM_KERNELS];
+}
+
+struct Simulator *newSimulator(int cacheSize, int associativity, const char *replacementPolicy, int blockSize){
+    struct Simulator *simulator = calloc(1, sizeof(struct Simulator));
+    simulator->cacheSize = cacheSize;
+    simulator->associativity = associativity;
+    simulator->blockSize = blockSize;
+    simulator->numSets = cacheSize / associativity / blockSize;
+    snprintf(simulator->replacementPolicy, sizeof(simulator->replacementPolicy), "%s", replacementPolicy);
+    simulator->policy = parsePolicy(replacementPolicy);
+    simulator->kernel = selectKernel(associativity, simulator->policy);
+    simulator->writes.writeAllocate = true;
+    simulator->cache = newCache(simulator->numSets, associativity, blockSize, simulator->policy);
+    if(simulator->cache == NULL){
+        free(simulator);
+        return NULL;
+    }
+    return simulator;
+}
+
+//anything but write through with write allocate, no prefetching, no instrumentation and no
+//miss classification runs on the full model kernel
+static void chooseKernel(struct Simulator *simulator){
+    bool specialized = defaultWritePolicy(simulator->writes) && simulator->prefetcher == NULL && simulator->stats == NULL && simulator->classifier == NULL;
+    simulator->kernel = specialized ? selectKernel(simulator->associativity, simulator->policy) : fullModelGeneric;
+}
+
+void setWritePolicy(struct Simulator *simulator, struct WritePolicy writes){
+    simulator->writes = writes;
+    chooseKernel(simulator);
+}
+
+void setPrefetcher(struct Simulator *simulator, struct PrefetchConfig config){
+    simulator->prefetcher = newPrefetcher(config, simulator->blockSize);
+    chooseKernel(simulator);
+}
+
+void setStats(struct Simulator *simulator, struct StatsStream *stats){
+    simulator->stats = stats;
+    addStatsLevel(stats, simulator->numSets);
+    chooseKernel(simulator);
+}
+
+//split misses into compulsory, capacity and conflict against a fully associative cache of
+//the same size
+void setMissClassifier(struct Simulator *simulator){
+    simulator->classifier = newMissClassifier(simulator->numSets * simulator->associativity);
+    chooseKernel(simulator);
+}
+
+void freeSimulator(struct Simulator *simulator){
+    if(simulator->prefetcher != NULL){
+        freePrefetcher(simulator->prefetcher);
+    }
+    if(simulator->classifier != NULL){
+        freeMissClassifier(simulator->classifier);
+    }
+    freeCache(simulator->cache);
+    free(simulator);
+}
+
+void cacheSimulator(void *simulatorPointer, struct TraceRecord *records, int count){
+    struct Simulator *simulator = simulatorPointer;
+    simulator->kernel(simulator, records, count);
+}
+
+static struct WindowTotals simulatorTotals(void *simulatorPointer){
+    struct Simulator *simulator = simulatorPointer;
+    return (struct WindowTotals){simulator->cacheHits, simulator->cacheMisses, simulator->memReads, simulator->memWrites};
+}
+
+//the counters of the result lines, for extrapolating them from a sample
+static int simulatorCounters(void *simulatorPointer, long *counters, char (*names)[SAMPLE_NAME_SIZE]){
+    struct Simulator *simulator = simulatorPointer;
+    static const char *counterNames[] = {"memread", "memwrite", "cachehit", "cachemiss", "dirtyevictions", "writebackbytes"};
+    counters[0] = simulator->memReads;
+    counters[1] = simulator->memWrites;
+    counters[2] = simulator->cacheHits;
+    counters[3] = simulator->cacheMisses;
+    counters[4] = simulator->dirtyEvictions;
+    counters[5] = simulator->dirtyEvictions * simulator->blockSize;
+    int numCounters = defaultWritePolicy(simulator->writes) ? 4 : 6;
+    for(int i = 0; names != NULL && i < numCounters; i ++){
+        snprintf(names[i], SAMPLE_NAME_SIZE, "%s", counterNames[i]);
+    }
+    if(simulator->prefetcher != NULL){
+        prefetchCounters(simulator->prefetcher, &counters[numCounters]);
+        for(int i = 0; names != NULL && i < NUM_PREFETCH_COUNTERS; i ++){
+            snprintf(names[numCounters + i], SAMPLE_NAME_SIZE, "%s", prefetchCounterNames[i]);
+        }
+        numCounters += NUM_PREFETCH_COUNTERS;
+    }
+    return numCounters;
+}
+
+//cacheSimulator writing a row to the stats stream at every window boundary
+static void windowedSimulator(void *simulatorPointer, struct TraceRecord *records, int count){
+    struct Simulator *simulator = simulatorPointer;
+    simulateWindowed(simulator->stats, simulator, cacheSimulator, simulatorTotals, records, count);
+}
+
+//Sets never interact, so one configuration can be split into contiguous runs of sets, each
+//simulated by its own thread. A run always covers whole words of valid bits so no two
+//threads write the same word.
+struct Partitioning{
+    int numSets;
+    int blockSize;
+    int setsPerGroup;
+    int numGroups;
+    int numPartitions;
+};
+
+int setOwner(void *context, unsigned long address){
+    struct Partitioning *partitioning = context;
+    unsigned long group = computeIndex(address, partitioning->numSets, partitioning->blockSize) / partitioning->setsPerGroup;
+    return group * partitioning->numPartitions / partitioning->numGroups;
+}
+
+//simulate a single configuration with up to numThreads threads, results match a sequential run
+void runSetPartitioned(struct TraceReader *reader, struct Simulator *simulator, int numThreads){
+    struct Partitioning partitioning;
+    partitioning.numSets = simulator->numSets;
+    partitioning.blockSize = simulator->blockSize;
+    partitioning.setsPerGroup = 1;
+    while(partitioning.setsPerGroup < 64 && (partitioning.setsPerGroup * simulator->associativity) % 64 != 0){
+        partitioning.setsPerGroup *= 2;
+    }
+    partitioning.numGroups = (simulator->numSets + partitioning.setsPerGroup - 1) / partitioning.setsPerGroup;
+    partitioning.numPartitions = numThreads < partitioning.numGroups ? numThreads : partitioning.numGroups;
+    if(partitioning.numPartitions > MAX_PARTITIONS){
+        partitioning.numPartitions = MAX_PARTITIONS;
+    }
+    //a prefetcher sees every set's misses and fills any set, and the fully associative shadow
+    //cache of the miss classifier sees every set's accesses, so neither can be split
+    if(partitioning.numPartitions < 2 || simulator->prefetcher != NULL || simulator->classifier != NULL){
+        runSweep(reader, (void **)&simulator, 1, cacheSimulator, 1);
+        return;
+    }
+    //each partition shares the cache but keeps its own counters
+    struct Simulator **partitions = malloc(partitioning.numPartitions * sizeof(struct Simulator *));
+    for(int i = 0; i < partitioning.numPartitions; i ++){
+        partitions[i] = calloc(1, sizeof(struct Simulator));
+        partitions[i]->cacheSize = simulator->cacheSize;
+        partitions[i]->associativity = simulator->associativity;
+        partitions[i]->blockSize = simulator->blockSize;
+        partitions[i]->numSets = simulator->numSets;
+        memcpy(partitions[i]->replacementPolicy, simulator->replacementPolicy, sizeof(simulator->replacementPolicy));
+        partitions[i]->policy = simulator->policy;
+        partitions[i]->kernel = simulator->kernel;
+        partitions[i]->writes = simulator->writes;
+        partitions[i]->cache = simulator->cache;
+    }
+    runPartitioned(reader, (void **)partitions, partitioning.numPartitions, cacheSimulator, setOwner, &partitioning);
+    for(int i = 0; i < partitioning.numPartitions; i ++){
+        simulator->memReads += partitions[i]->memReads;
+        simulator->memWrites += partitions[i]->memWrites;
+        simulator->cacheHits += partitions[i]->cacheHits;
+        simulator->cacheMisses += partitions[i]->cacheMisses;
+        simulator->dirtyEvictions += partitions[i]->dirtyEvictions;
+        free(partitions[i]);
+    }
+    free(partitions);
+}
+
+//the write back counters only appear when the write policy isn't the original one
+void printResults(struct Simulator *simulator){
+    printf("memread:%ld\nmemwrite:%ld\ncachehit:%ld\ncachemiss:%ld\n", simulator->memReads, simulator->memWrites, simulator->cacheHits, simulator->cacheMisses);
+    if(!defaultWritePolicy(simulator->writes)){
+        printf("dirtyevictions:%ld\nwritebackbytes:%ld\n", simulator->dirtyEvictions, simulator->dirtyEvictions * simulator->blockSize);
+    }
+    if(simulator->prefetcher != NULL){
+        printPrefetchStats(simulator->prefetcher, stdout, false);
+    }
+    if(simulator->classifier != NULL){
+        printMissClasses(simulator->classifier, stdout, false);
+    }
+}
+
+//one line per configuration, prefixed with the configuration in the same form as the positional arguments
+void printSweepRow(struct Simulator *simulator){
+    printf("%d assoc:%d %s %d memread:%ld memwrite:%ld cachehit:%ld cachemiss:%ld", simulator->cacheSize, simulator->associativity, simulator->replacementPolicy, simulator->blockSize, simulator->memReads, simulator->memWrites, simulator->cacheHits, simulator->cacheMisses);
+    if(!defaultWritePolicy(simulator->writes)){
+        printf(" dirtyevictions:%ld writebackbytes:%ld", simulator->dirtyEvictions, simulator->dirtyEvictions * simulator->blockSize);
+    }
+    if(simulator->prefetcher != NULL){
+        printPrefetchStats(simulator->prefetcher, stdout, true);
+    }
+    if(simulator->classifier != NULL){
+        printMissClasses(simulator->classifier, stdout, true);
+    }
+    printf("\n");
+}
+
+//each line of a sweep file has the four positional arguments, any of which may be a list or range:
+//    1024-65536 assoc:1-16 fifo,lru 16,64
+//every valid combination becomes one simulator, returns the number of simulators or -1 on error
+int readSweepFile(char *path, struct Simulator ***simulatorsOut){
+    FILE *file = fopen(path, "r");
+    if(file == NULL){
+        return -1;
+    }
+    int numSimulators = 0;
+    int capacity = 16;
+    struct Simulator **simulators = malloc(capacity * sizeof(struct Simulator *));
+    char line[1024];
+    while(fgets(line, sizeof(line), file) != NULL){
+        char *fields[4];
+        int numFields = 0;
+        char *save;
+        for(char *field = strtok_r(line, " \t\r\n", &save); field != NULL && numFields < 4; field = strtok_r(NULL, " \t\r\n", &save)){
+            fields[numFields ++] = field;
+        }
+        if(numFields == 0 || fields[0][0] == '#'){
+            continue;
+        }
+        if(numFields < 4 || strncmp(fields[1], "assoc:", 6) != 0){
+            fprintf(stderr, "bad sweep line starting with %s\n", fields[0]);
+            continue;
+        }
+        int sizes[MAX_SWEEP_VALUES];
+        int associativities[MAX_SWEEP_VALUES];
+        int blockSizes[MAX_SWEEP_VALUES];
+        int numSizes = parseSweepValues(fields[0], sizes);
+        int numAssociativities = parseSweepValues(&fields[1][6], associativities);
+        int numBlockSizes = parseSweepValues(fields[3], blockSizes);
+        char *policySave;
+        for(char *policy = strtok_r(fields[2], ",", &policySave); policy != NULL; policy = strtok_r(NULL, ",", &policySave)){
+            for(int s = 0; s < numSizes; s ++){
+                for(int a = 0; a < numAssociativities; a ++){
+                    for(int b = 0; b < numBlockSizes; b ++){
+                        //skip geometries that don't divide into a whole number of sets
+                        if((long)associativities[a] * blockSizes[b] > sizes[s] || sizes[s] % (associativities[a] * blockSizes[b]) != 0){
+                            continue;
+                        }
+                        if(numSimulators == capacity){
+                            capacity *= 2;
+                            simulators = realloc(simulators, capacity * sizeof(struct Simulator *));
+                        }
+                        simulators[numSimulators] = newSimulator(sizes[s], associativities[a], policy, blockSizes[b]);
+                        if(simulators[numSimulators] == NULL){
+                            fprintf(stderr, "can't allocate a %d byte cache\n", sizes[s]);
+                            fclose(file);
+                            for(int i = 0; i < numSimulators; i ++){
+                                freeSimulator(simulators[i]);
+                            }
+                            free(simulators);
+                            return -1;
+                        }
+                        numSimulators ++;
+                    }
+                }
+            }
+        }
     }
-    printf("memread:%d\nmemwrite:%d\ncachehit:%d\ncachemiss:%d\n", memReads, memWrites, cacheHits, cacheMisses);
     fclose(file);
+    *simulatorsOut = simulators;
+    return numSimulators;
+}
+
+//first --mrc <max cache size> assoc:n lru <block size> <trace>
+//one stack distance pass gives the result of every power of two cache size up to the maximum,
+//printed one row per size in the same form as a sweep
+int missRatioCurve(struct TraceReader *reader, int maxCacheSize, int associativity, char *replacementPolicy, int blockSize){
+    if(strcmp(replacementPolicy, "lru") != 0){
+        fprintf(stderr, "miss ratio curves need the lru policy\n");
+        return EXIT_FAILURE;
+    }
+    int maxLevel = 0;
+    while((2L << maxLevel) * associativity * blockSize <= maxCacheSize){
+        maxLevel ++;
+    }
+    struct StackDistance *stackDistance = newStackDistance(blockSize, maxLevel, associativity);
+    struct TraceRecord records[TRACE_BATCH_SIZE];
+    int count;
+    while((count = readTraceBatch(reader, records, TRACE_BATCH_SIZE)) > 0){
+        for(int r = 0; r < count; r ++){
+            recordAccess(stackDistance, records[r].memAction, records[r].address);
+        }
+    }
+    if(traceReadFailed(reader)){
+        freeStackDistance(stackDistance);
+        return EXIT_FAILURE;
+    }
+    for(int level = 0; level <= maxLevel; level ++){
+        long cacheSize = (1L << level) * associativity * blockSize;
+        unsigned long hits = stackDistanceHits(stackDistance, level, associativity);
+        unsigned long misses = stackDistance->accesses - hits;
+        printf("%ld assoc:%d %s %d memread:%lu memwrite:%lu cachehit:%lu cachemiss:%lu missratio:%.6f\n", cacheSize, associativity, replacementPolicy, blockSize, misses, stackDistance->writes, hits, misses, stackDistance->accesses > 0 ? (double)misses / stackDistance->accesses : 0);
+    }
+    freeStackDistance(stackDistance);
+    return EXIT_SUCCESS;
+}
+
+static double secondsSince(struct timespec *start){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+//records simulated per second, -1 when the cache can't be allocated
+static double kernelRate(Kernel kernel, enum SetScan scan, int associativity, const char *replacementPolicy, struct TraceRecord *records, long count){
+    struct Simulator *simulator = newSimulator(KERNEL_BENCH_CACHE_SIZE, associativity, replacementPolicy, KERNEL_BENCH_BLOCK_SIZE);
+    if(simulator == NULL){
+        fprintf(stderr, "can't allocate a %d byte cache\n", KERNEL_BENCH_CACHE_SIZE);
+        return -1;
+    }
+    useSetScan(simulator->cache, scan);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(long done = 0; done < count; done += TRACE_BATCH_SIZE){
+        kernel(simulator, &records[done], count - done < TRACE_BATCH_SIZE ? count - done : TRACE_BATCH_SIZE);
+    }
+    double seconds = secondsSince(&start);
+    freeSimulator(simulator);
+    return seconds > 0 ? count / seconds : 0;
+}
+
+//first --kernel-bench <trace>
+//times every specialized kernel against the generic path on the same in memory records,
+//then the generic path on wide sets with the vector set scan against the scalar one
+//(build without -fsanitize=address for meaningful numbers)
+int kernelBenchmark(struct TraceReader *reader){
+    long capacity = 1 << 20;
+    long count = 0;
+    struct TraceRecord *records = malloc(capacity * sizeof(struct TraceRecord));
+    int read;
+    while(count < KERNEL_BENCH_MAX_RECORDS && (read = readTraceBatch(reader, &records[count], TRACE_BATCH_SIZE)) > 0){
+        count += read;
+        if(capacity - count < TRACE_BATCH_SIZE){
+            capacity *= 2;
+            records = realloc(records, capacity * sizeof(struct TraceRecord));
+        }
+    }
+    if(traceReadFailed(reader)){
+        free(records);
+        return EXIT_FAILURE;
+    }
+    for(int policy = 0; policy < NUM_POLICIES; policy ++){
+        for(int i = 0; i < NUM_KERNELS; i ++){
+            int associativity = 1 << i;
+            double specialized = kernelRate(kernels[policy][i], SCAN_SCALAR, associativity, policyName(policy), records, count);
+            double generic = kernelRate(kernels[policy][NUM_KERNELS], SCAN_SCALAR, associativity, policyName(policy), records, count);
+            if(specialized < 0 || generic < 0){
+                free(records);
+                return EXIT_FAILURE;
+            }
+            printf("kernel:%s assoc:%d specialized:%.0f generic:%.0f speedup:%.2f\n", policyName(policy), associativity, specialized, generic, generic > 0 ? specialized / generic : 0);
+        }
+    }
+    enum SetScan scan = bestSetScan();
+    for(int policy = 0; policy < NUM_POLICIES; policy ++){
+        for(int associativity = 16; associativity <= 64; associativity *= 2){
+            double vector = kernelRate(kernels[policy][NUM_KERNELS], scan, associativity, policyName(policy), records, count);
+            double scalar = kernelRate(kernels[policy][NUM_KERNELS], SCAN_SCALAR, associativity, policyName(policy), records, count);
+            if(vector < 0 || scalar < 0){
+                free(records);
+                return EXIT_FAILURE;
+            }
+            printf("scan:%s %s assoc:%d vector:%.0f scalar:%.0f speedup:%.2f\n", setScanName(scan), policyName(policy), associativity, vector, scalar, scalar > 0 ? vector / scalar : 0);
+        }
+    }
+    free(records);
+    return EXIT_SUCCESS;
 }
 
 int main(int argc, char* argv[argc + 1]){
-    int cacheSize = atoi(argv[1]);
-    char* associativityArg = argv[2];
-    char associativityString[strlen(associativityArg)];
-    strncpy(associativityString, &associativityArg[6], strlen(associativityArg));
-    int associativity = atoi(associativityString);
-    char* replacementPolicy = argv[3];
-    int blockSize = atoi(argv[4]);
-    int numSets = cacheSize / associativity / blockSize;
-    FILE *file = fopen(argv[5], "r");
-    if(file == NULL){
-        printf("error");
+    //leading options, the positional arguments follow them
+    bool verbose = false;
+    char *sweepPath = NULL;
+    int numThreads = 1;
+    bool curve = false;
+    struct WritePolicy writes = {.writeBack = false, .writeAllocate = true};
+    bool prefetch = false;
+    struct PrefetchConfig prefetchConfig;
+    int prefetchLatency = 0;
+    unsigned long seed = DEFAULT_REPLACEMENT_SEED;
+    char *statsPath = NULL;
+    unsigned long statsWindow = DEFAULT_STATS_WINDOW;
+    bool classify = false;
+    struct SampleConfig sampling = {.setRatio = 1};
+    bool sampled = false;
+    int option = 1;
+    while(option < argc && argv[option][0] == '-' && argv[option][1] != '\0'){
+        if(strcmp(argv[option], "-v") == 0){
+            verbose = true;
+        }
+        else if(strcmp(argv[option], "--sweep") == 0 && option + 1 < argc){
+            sweepPath = argv[++ option];
+        }
+        else if(strcmp(argv[option], "--kernel-bench") == 0 && option + 1 < argc){
+            struct TraceReader *reader = openTrace(argv[++ option]);
+            if(reader == NULL){
+                return traceOpenFailure();
+            }
+            int status = kernelBenchmark(reader);
+            closeTrace(reader);
+            return status;
+        }
+        else if(strcmp(argv[option], "--mrc") == 0){
+            curve = true;
+        }
+        else if(strcmp(argv[option], "--write-back") == 0){
+            writes.writeBack = true;
+        }
+        else if(strcmp(argv[option], "--no-write-allocate") == 0){
+            writes.writeAllocate = false;
+        }
+        else if(strcmp(argv[option], "--prefetch") == 0 && option + 1 < argc){
+            prefetch = parsePrefetchConfig(argv[++ option], &prefetchConfig);
+            if(!prefetch){
+                fprintf(stderr, "bad prefetcher %s\n", argv[option]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(argv[option], "--prefetch-latency") == 0 && option + 1 < argc){
+            prefetchLatency = atoi(argv[++ option]);
+        }
+        else if(strcmp(argv[option], "--threads") == 0 && option + 1 < argc){
+            numThreads = atoi(argv[++ option]);
+        }
+        else if(strcmp(argv[option], "--seed") == 0 && option + 1 < argc){
+            seed = strtoul(argv[++ option], NULL, 10);
+        }
+        else if(strcmp(argv[option], "--3c") == 0){
+            classify = true;
+        }
+        else if(strcmp(argv[option], "--stats") == 0 && option + 1 < argc){
+            statsPath = argv[++ option];
+        }
+        else if(strcmp(argv[option], "--stats-window") == 0 && option + 1 < argc){
+            statsWindow = strtoul(argv[++ option], NULL, 10);
+            if(statsWindow == 0){
+                fprintf(stderr, "bad stats window %s\n", argv[option]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(argv[option], "--sample-sets") == 0 && option + 1 < argc){
+            sampling.setRatio = strtoul(argv[++ option], NULL, 10);
+            if(sampling.setRatio < 2){
+                fprintf(stderr, "bad set sampling ratio %s\n", argv[option]);
+                return EXIT_FAILURE;
+            }
+            sampled = true;
+        }
+        else if(strcmp(argv[option], "--sample-intervals") == 0 && option + 1 < argc){
+            if(!parseIntervalSampling(argv[++ option], &sampling)){
+                fprintf(stderr, "bad sampling intervals %s\n", argv[option]);
+                return EXIT_FAILURE;
+            }
+            sampled = true;
+        }
+        else{
+            fprintf(stderr, "unknown option %s\n", argv[option]);
+            return EXIT_FAILURE;
+        }
+        option ++;
+    }
+    argv += option - 1;
+    if(statsPath != NULL && (sweepPath != NULL || curve)){
+        fprintf(stderr, "--stats needs a single configuration\n");
+        return EXIT_FAILURE;
+    }
+    //a sample estimates plain counters of one configuration
+    if(sampled && (sweepPath != NULL || curve || statsPath != NULL || classify)){
+        fprintf(stderr, "sampling needs a single configuration without --stats or --3c\n");
+        return EXIT_FAILURE;
+    }
+    if(sampling.setRatio > 1 && sampling.period > 0){
+        fprintf(stderr, "set sampling can't be combined with interval sampling\n");
+        return EXIT_FAILURE;
+    }
+    //a prefetcher fills sets other than the one it trains on, which set sampling can't follow
+    if(sampling.setRatio > 1 && prefetch){
+        fprintf(stderr, "set sampling can't be combined with a prefetcher\n");
+        return EXIT_FAILURE;
+    }
+    struct Simulator **simulators;
+    int numSimulators;
+    char *tracePath;
+    if(sweepPath != NULL){
+        //first --sweep <sweep file> <trace file>
+        numSimulators = readSweepFile(sweepPath, &simulators);
+        tracePath = argv[1];
+        if(numSimulators < 0){
+            printf("error");
+            return EXIT_SUCCESS;
+        }
     }
     else{
-        //printf("cache size:%d assoc:%d policy:%s block size:%d numSets:%d\n", cacheSize, associativity, replacementPolicy, blockSize, numSets);
-        struct Cache *cache = newCache(numSets, associativity, blockSize);
-        cacheSimulator(file, cache, associativity, blockSize, numSets, replacementPolicy);
-        freeCache(cache);
+        int cacheSize = atoi(argv[1]);
+        char* associativityArg = argv[2];
+        char associativityString[strlen(associativityArg)];
+        strncpy(associativityString, &associativityArg[6], strlen(associativityArg));
+        int associativity = atoi(associativityString);
+        char* replacementPolicy = argv[3];
+        int blockSize = atoi(argv[4]);
+        tracePath = argv[5];
+        if(curve){
+            struct TraceReader *reader = openTrace(tracePath);
+            if(reader == NULL){
+                return traceOpenFailure();
+            }
+            int status = missRatioCurve(reader, cacheSize, associativity, replacementPolicy, blockSize);
+            closeTrace(reader);
+            return status;
+        }
+        //printf("cache size:%d assoc:%d policy:%s block size:%d\n", cacheSize, associativity, replacementPolicy, blockSize);
+        simulators = malloc(sizeof(struct Simulator *));
+        simulators[0] = newSimulator(cacheSize, associativity, replacementPolicy, blockSize);
+        if(simulators[0] == NULL){
+            fprintf(stderr, "can't allocate a %d byte cache\n", cacheSize);
+            free(simulators);
+            return EXIT_FAILURE;
+        }
+        numSimulators = 1;
     }
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    for(int i = 0; i < numSimulators; i ++){
+        setWritePolicy(simulators[i], writes);
+        seedReplacement(&simulators[i]->cache->replacement, seed);
+        if(prefetch){
+            prefetchConfig.latency = prefetchLatency;
+            setPrefetcher(simulators[i], prefetchConfig);
+        }
+        if(classify){
+            setMissClassifier(simulators[i]);
+        }
+    }
+    struct StatsStream *stats = NULL;
+    if(statsPath != NULL){
+        stats = newStatsStream(statsPath, statsWindow);
+        if(stats == NULL){
+            fprintf(stderr, "can't write %s\n", statsPath);
+            return EXIT_FAILURE;
+        }
+        setStats(simulators[0], stats);
+    }
+    struct Sampler *sampler = NULL;
+    if(sampled){
+        sampler = newSampler(sampling, simulators[0]->numSets, simulators[0]->blockSize, simulators[0], simulatorCounters);
+        if(sampler == NULL){
+            fprintf(stderr, "set sampling 1 in %lu leaves fewer than two of the %d sets\n", sampling.setRatio, simulators[0]->numSets);
+            freeSimulator(simulators[0]);
+            free(simulators);
+            return EXIT_FAILURE;
+        }
+    }
+    int status = EXIT_SUCCESS;
+    struct TraceReader *reader = openTrace(tracePath);
+    if(reader == NULL){
+        status = traceOpenFailure();
+    }
+    else if(sampler != NULL){
+        runSampled(sampler, reader, simulators[0], cacheSimulator);
+        if(traceReadFailed(reader)){
+            status = EXIT_FAILURE;
+        }
+        else{
+            printSampledResults(sampler, stdout);
+        }
+        if(verbose){
+            printTraceStats(reader, stderr);
+        }
+        closeTrace(reader);
+    }
+    else{
+        //windows follow trace order, so an instrumented run can't be split across threads
+        if(stats != NULL){
+            runSweep(reader, (void **)simulators, 1, windowedSimulator, 1);
+        }
+        else if(numSimulators == 1 && numThreads > 1){
+            runSetPartitioned(reader, simulators[0], numThreads);
+        }
+        else{
+            runSweep(reader, (void **)simulators, numSimulators, cacheSimulator, numThreads);
+        }
+        if(traceReadFailed(reader)){
+            status = EXIT_FAILURE;
+        }
+        else if(sweepPath != NULL){
+            for(int i = 0; i < numSimulators; i ++){
+                printSweepRow(simulators[i]);
+            }
+        }
+        else{
+            printResults(simulators[0]);
+        }
+        if(verbose){
+            printTraceStats(reader, stderr);
+        }
+        closeTrace(reader);
+    }
+    if(stats != NULL && !closeStatsStream(stats, simulators[0], simulatorTotals)){
+        fprintf(stderr, "can't write %s\n", statsPath);
+    }
+    if(sampler != NULL){
+        freeSampler(sampler);
+    }
+    for(int i = 0; i < numSimulators; i ++){
+        freeSimulator(simulators[i]);
+    }
+    free(simulators);
+    return status;
+}
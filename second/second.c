@@ -1,329 +1,500 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
 #include <stdbool.h>
+#include "hierarchy.h"
+#include "trace.h"
+#include "sweep.h"
 
-struct Cache{
-    int numSets;
-    struct Set **setArray;
-};
-
-struct Set{
-    unsigned long index;
-    int numBlocks;
-    struct Block **blockArray;
-};
+//the original two level simulator: an exclusive L2 that acts as a victim cache for the L1
+struct Hierarchy *newSimulator(int L1CacheSize, int L1Associativity, char *L1Policy, int blockSize, int L2CacheSize, int L2Associativity, char *L2Policy){
+    struct LevelConfig configs[2];
+    configs[0].cacheSize = L1CacheSize;
+    configs[0].associativity = L1Associativity;
+    snprintf(configs[0].policy, sizeof(configs[0].policy), "%s", L1Policy);
+    configs[1].cacheSize = L2CacheSize;
+    configs[1].associativity = L2Associativity;
+    snprintf(configs[1].policy, sizeof(configs[1].policy), "%s", L2Policy);
+    return newHierarchy(configs, 2, blockSize, INCLUSION_EXCLUSIVE);
+}
 
-struct Block{
-    int valid;
-    unsigned long tag;
-    int blockSize;
-    int age;
-    unsigned long address;
-};
+//one line per configuration, prefixed with the configuration in the same form as the positional arguments
+void printSweepRow(struct Hierarchy *hierarchy){
+    struct Level *L1 = &hierarchy->levels[0];
+    struct Level *L2 = &hierarchy->levels[1];
+    printf("%d assoc:%d %s %d %d assoc:%d %s memread:%ld memwrite:%ld l1cachehit:%ld l1cachemiss:%ld l2cachehit:%ld l2cachemiss:%ld", L1->config.cacheSize, L1->config.associativity, L1->config.policy, hierarchy->blockSize, L2->config.cacheSize, L2->config.associativity, L2->config.policy, hierarchy->memReads, hierarchy->memWrites, L1->hits, L1->misses, L2->hits, L2->misses);
+    if(!defaultWritePolicy(hierarchy->writes)){
+        printf(" l1dirtyevictions:%ld l1writebackbytes:%ld l2dirtyevictions:%ld l2writebackbytes:%ld", L1->dirtyEvictions, L1->dirtyEvictions * hierarchy->blockSize, L2->dirtyEvictions, L2->dirtyEvictions * hierarchy->blockSize);
+    }
+    if(hierarchy->prefetcher != NULL){
+        printPrefetchStats(hierarchy->prefetcher, stdout, true);
+    }
+    printf("\n");
+}
 
-struct Cache *newCache(int numSets, int associativity, int blockSize){
-    unsigned long index = 0;
-    struct Cache *cache = malloc(sizeof(struct Cache));
-    cache->numSets = numSets;
-    cache->setArray = malloc(numSets * sizeof(struct Set));
-    for(int i = 0; i < numSets; i ++){
-        cache->setArray[i] = malloc(sizeof(struct Set));
-        cache->setArray[i]->index = index;
-        cache->setArray[i]->numBlocks = associativity;
-        cache->setArray[i]->blockArray = malloc(associativity * sizeof(struct Block));
-        index ++;
-        for(int j = 0; j < associativity; j ++){
-            cache->setArray[i]->blockArray[j] = malloc(sizeof(struct Block));
-            cache->setArray[i]->blockArray[j]->valid = 0;
-            cache->setArray[i]->blockArray[j]->tag = 0;
-            cache->setArray[i]->blockArray[j]->blockSize = blockSize;
-            cache->setArray[i]->blockArray[j]->age = -1;
-            cache->setArray[i]->blockArray[j]->address = 0;
+//each line of a sweep file has the seven positional arguments, and the sizes, associativities
+//and policies may each be a list or range:
+//    1024-4096 assoc:2,4 lru 64 32768-262144 assoc:8-16 lru
+//every valid combination becomes one simulator, returns the number of simulators or -1 on error
+int readSweepFile(char *path, struct Hierarchy ***simulatorsOut){
+    FILE *file = fopen(path, "r");
+    if(file == NULL){
+        return -1;
+    }
+    int numSimulators = 0;
+    int capacity = 16;
+    struct Hierarchy **simulators = malloc(capacity * sizeof(struct Hierarchy *));
+    char line[1024];
+    while(fgets(line, sizeof(line), file) != NULL){
+        char *fields[7];
+        int numFields = 0;
+        char *save;
+        for(char *field = strtok_r(line, " \t\r\n", &save); field != NULL && numFields < 7; field = strtok_r(NULL, " \t\r\n", &save)){
+            fields[numFields ++] = field;
+        }
+        if(numFields == 0 || fields[0][0] == '#'){
+            continue;
+        }
+        if(numFields < 7 || strncmp(fields[1], "assoc:", 6) != 0 || strncmp(fields[5], "assoc:", 6) != 0){
+            fprintf(stderr, "bad sweep line starting with %s\n", fields[0]);
+            continue;
+        }
+        int L1Sizes[MAX_SWEEP_VALUES];
+        int L1Associativities[MAX_SWEEP_VALUES];
+        int blockSizes[MAX_SWEEP_VALUES];
+        int L2Sizes[MAX_SWEEP_VALUES];
+        int L2Associativities[MAX_SWEEP_VALUES];
+        int numL1Sizes = parseSweepValues(fields[0], L1Sizes);
+        int numL1Associativities = parseSweepValues(&fields[1][6], L1Associativities);
+        int numBlockSizes = parseSweepValues(fields[3], blockSizes);
+        int numL2Sizes = parseSweepValues(fields[4], L2Sizes);
+        int numL2Associativities = parseSweepValues(&fields[5][6], L2Associativities);
+        char *L1Policies[MAX_SWEEP_VALUES];
+        char *L2Policies[MAX_SWEEP_VALUES];
+        int numL1Policies = 0;
+        int numL2Policies = 0;
+        for(char *policy = strtok_r(fields[2], ",", &save); policy != NULL && numL1Policies < MAX_SWEEP_VALUES; policy = strtok_r(NULL, ",", &save)){
+            L1Policies[numL1Policies ++] = policy;
+        }
+        for(char *policy = strtok_r(fields[6], ",", &save); policy != NULL && numL2Policies < MAX_SWEEP_VALUES; policy = strtok_r(NULL, ",", &save)){
+            L2Policies[numL2Policies ++] = policy;
+        }
+        for(int s1 = 0; s1 < numL1Sizes; s1 ++){
+            for(int a1 = 0; a1 < numL1Associativities; a1 ++){
+                for(int p1 = 0; p1 < numL1Policies; p1 ++){
+                    for(int b = 0; b < numBlockSizes; b ++){
+                        for(int s2 = 0; s2 < numL2Sizes; s2 ++){
+                            for(int a2 = 0; a2 < numL2Associativities; a2 ++){
+                                for(int p2 = 0; p2 < numL2Policies; p2 ++){
+                                    //skip geometries that don't divide into a whole number of sets
+                                    if(!validGeometry(L1Sizes[s1], L1Associativities[a1], blockSizes[b]) || !validGeometry(L2Sizes[s2], L2Associativities[a2], blockSizes[b])){
+                                        continue;
+                                    }
+                                    if(numSimulators == capacity){
+                                        capacity *= 2;
+                                        simulators = realloc(simulators, capacity * sizeof(struct Hierarchy *));
+                                    }
+                                    simulators[numSimulators] = newSimulator(L1Sizes[s1], L1Associativities[a1], L1Policies[p1], blockSizes[b], L2Sizes[s2], L2Associativities[a2], L2Policies[p2]);
+                                    if(simulators[numSimulators] == NULL){
+                                        fprintf(stderr, "can't allocate a %d byte L1 and %d byte L2\n", L1Sizes[s1], L2Sizes[s2]);
+                                        fclose(file);
+                                        for(int i = 0; i < numSimulators; i ++){
+                                            freeHierarchy(simulators[i]);
+                                        }
+                                        free(simulators);
+                                        return -1;
+                                    }
+                                    numSimulators ++;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
         }
     }
-    return cache;
+    fclose(file);
+    *simulatorsOut = simulators;
+    return numSimulators;
 }
 
-void freeCache(struct Cache *cache){
-    for(int i = 0; i < cache->numSets; i ++){
-        for(int j = 0; j < cache->setArray[i]->numBlocks; j ++){
-            free(cache->setArray[i]->blockArray[j]);
-        }
-        free(cache->setArray[i]->blockArray);
-        free(cache->setArray[i]);
+//simulateHierarchy writing a row to the stats stream at every window boundary
+static void windowedHierarchy(void *hierarchyPointer, struct TraceRecord *records, int count){
+    struct Hierarchy *hierarchy = hierarchyPointer;
+    simulateWindowed(hierarchy->stats, hierarchy, simulateHierarchy, hierarchyTotals, records, count);
+}
+
+//The last records simulated, kept for the fingerprint of the next checkpoint. Record i of
+//the trace goes into slot i % CHECKPOINT_FINGERPRINT_RECORDS.
+struct RecentRecords{
+    struct TraceRecord records[CHECKPOINT_FINGERPRINT_RECORDS];
+};
+
+static void noteRecent(struct RecentRecords *recent, unsigned long first, struct TraceRecord *records, int count){
+    int skipped = count > CHECKPOINT_FINGERPRINT_RECORDS ? count - CHECKPOINT_FINGERPRINT_RECORDS : 0;
+    for(int i = skipped; i < count; i ++){
+        recent->records[(first + i) % CHECKPOINT_FINGERPRINT_RECORDS] = records[i];
     }
-    free(cache->setArray);
-    free(cache);
 }
 
-unsigned long computeIndex(unsigned long address, int numSets, int blockSize){
-    unsigned long b = log2l(blockSize);
-    return ((address >> b) & (numSets - 1));
+//where a checkpoint taken after records records of the trace is
+static struct TracePosition tracePosition(struct TraceReader *reader, struct RecentRecords *recent, unsigned long records){
+    struct TraceRecord last[CHECKPOINT_FINGERPRINT_RECORDS];
+    int count = records < CHECKPOINT_FINGERPRINT_RECORDS ? (int)records : CHECKPOINT_FINGERPRINT_RECORDS;
+    for(int i = 0; i < count; i ++){
+        last[i] = recent->records[(records - count + i) % CHECKPOINT_FINGERPRINT_RECORDS];
+    }
+    return (struct TracePosition){records, reader->binary ? reader->header.recordCount : 0, hashTraceRecords(last, count)};
 }
 
-unsigned long computeTag(unsigned long address, int numSets, int blockSize){
-    unsigned long b = log2l(blockSize);
-    unsigned long n = log2l(numSets);
-    return (address >> (b + n));
+//Moves the reader to a checkpoint's position, reading the records its fingerprint covers
+//into recent. Returns false when the trace isn't the one the checkpoint was taken on or ends
+//before the position.
+static bool seekCheckpoint(struct TraceReader *reader, struct TracePosition *position, struct RecentRecords *recent){
+    if(position->traceRecords != (reader->binary ? reader->header.recordCount : 0)){
+        return false;
+    }
+    int count = position->records < CHECKPOINT_FINGERPRINT_RECORDS ? (int)position->records : CHECKPOINT_FINGERPRINT_RECORDS;
+    unsigned long first = position->records - count;
+    if(skipTraceRecords(reader, first) < first){
+        return false;
+    }
+    struct TraceRecord last[CHECKPOINT_FINGERPRINT_RECORDS];
+    int read = 0;
+    while(read < count){
+        int batch = readTraceBatch(reader, &last[read], count - read);
+        if(batch == 0){
+            return false;
+        }
+        read += batch;
+    }
+    noteRecent(recent, first, last, count);
+    return hashTraceRecords(last, count) == position->fingerprint;
 }
 
-void cacheSimulator(FILE *file, struct Cache *L1Cache, struct Cache *L2Cache, int L1Associativity, int L2Associativity, int blockSize, int L1NumSets, int L2NumSets, char *L1Policy, char *L2Policy){
-    int age = 0;
-    int memReads = 0;
-    int memWrites = 0;
-    int L1CacheHits = 0;
-    int L1CacheMisses = 0;
-    int L2CacheHits = 0;
-    int L2CacheMisses = 0;
-    char memAction;
-    unsigned long address;
-    unsigned long index;
-    unsigned long tag;
-    bool L1CacheHit;
-    bool L2CacheHit;
-    bool L1SpaceAvailable;
-    bool L2SpaceAvailable;
-    while(fscanf(file, "%c %lx %*[\n]", &memAction, &address) != EOF){
-        L1CacheHit = false;
-        L2CacheHit = false;
-        L1SpaceAvailable = false;
-        L2SpaceAvailable = false;
-        index = computeIndex(address, L1NumSets, blockSize);
-        tag = computeTag(address, L1NumSets, blockSize);
-        for(int i = 0; i < L1Associativity; i ++){
-            //Check for valid blocks with same tag
-            if(L1Cache->setArray[index]->blockArray[i]->tag == tag && L1Cache->setArray[index]->blockArray[i]->valid == 1){
-                L1CacheHit = true;
-                L1CacheHits ++;
-                L1Cache->setArray[index]->blockArray[i]->address = address;
-                //update age if lru
-                if(strcmp(L1Policy, "lru") == 0){
-                    L1Cache->setArray[index]->blockArray[i]->age = age;
-                }
-                //update memwrites if applicable
-                if(memAction == 'W'){
-                    memWrites ++;
-                }
-                break;
+//Runs one hierarchy from record start of the trace (the reader is already there) up to limit
+//records in total, 0 for the whole trace, saving a checkpoint every records when every isn't
+//0 and once more at the end. Returns false if a checkpoint couldn't be written.
+static bool runCheckpointed(struct TraceReader *reader, struct Hierarchy *hierarchy, SimulateFunction simulate, struct RecentRecords *recent, unsigned long start, unsigned long limit, const char *checkpointPath, unsigned long every){
+    struct TraceRecord records[TRACE_BATCH_SIZE];
+    unsigned long done = start;
+    while(limit == 0 || done < limit){
+        //batches end on checkpoint boundaries and at the limit
+        unsigned long wanted = TRACE_BATCH_SIZE;
+        if(limit > 0 && limit - done < wanted){
+            wanted = limit - done;
+        }
+        if(checkpointPath != NULL && every > 0 && every - done % every < wanted){
+            wanted = every - done % every;
+        }
+        int count = readTraceBatch(reader, records, (int)wanted);
+        if(count == 0){
+            break;
+        }
+        simulate(hierarchy, records, count);
+        noteRecent(recent, done, records, count);
+        done += count;
+        if(checkpointPath != NULL && every > 0 && done % every == 0){
+            struct TracePosition position = tracePosition(reader, recent, done);
+            if(!saveCheckpoint(hierarchy, checkpointPath, &position)){
+                return false;
             }
         }
-        //if L1 cache miss, check L2
-        if(!L1CacheHit){
-            L1CacheMisses ++;
-            index = computeIndex(address, L2NumSets, blockSize);
-            tag = computeTag(address, L2NumSets, blockSize);
-            for(int i = 0; i < L2Associativity; i ++){
-                //if L2 cache hit, evict and move to L1
-                if(L2Cache->setArray[index]->blockArray[i]->tag == tag && L2Cache->setArray[index]->blockArray[i]->valid == 1){
-                    L2CacheHit = true;
-                    L2CacheHits ++;
-                    //invalidate block in L2 before moving to L1
-                    L2Cache->setArray[index]->blockArray[i]->valid = 0;
-                    break;
-                }
+    }
+    if(checkpointPath == NULL){
+        return true;
+    }
+    struct TracePosition position = tracePosition(reader, recent, done);
+    return saveCheckpoint(hierarchy, checkpointPath, &position);
+}
+
+int main(int argc, char* argv[argc + 1]){
+    //leading options, the positional arguments follow them
+    bool verbose = false;
+    char *sweepPath = NULL;
+    char *configPath = NULL;
+    int numThreads = 1;
+    bool writeBack = false;
+    bool noWriteAllocate = false;
+    bool prefetch = false;
+    struct PrefetchConfig prefetchConfig;
+    int prefetchLatency = 0;
+    unsigned long seed = DEFAULT_REPLACEMENT_SEED;
+    char *statsPath = NULL;
+    unsigned long statsWindow = DEFAULT_STATS_WINDOW;
+    char *checkpointPath = NULL;
+    unsigned long checkpointEvery = 0;
+    char *resumePath = NULL;
+    bool warm = false;
+    unsigned long recordLimit = 0;
+    struct SampleConfig sampling = {.setRatio = 1};
+    bool sampled = false;
+    int option = 1;
+    while(option < argc && argv[option][0] == '-' && argv[option][1] != '\0'){
+        if(strcmp(argv[option], "-v") == 0){
+            verbose = true;
+        }
+        else if(strcmp(argv[option], "--sweep") == 0 && option + 1 < argc){
+            sweepPath = argv[++ option];
+        }
+        else if(strcmp(argv[option], "--config") == 0 && option + 1 < argc){
+            configPath = argv[++ option];
+        }
+        else if(strcmp(argv[option], "--write-back") == 0){
+            writeBack = true;
+        }
+        else if(strcmp(argv[option], "--no-write-allocate") == 0){
+            noWriteAllocate = true;
+        }
+        else if(strcmp(argv[option], "--prefetch") == 0 && option + 1 < argc){
+            prefetch = parsePrefetchConfig(argv[++ option], &prefetchConfig);
+            if(!prefetch){
+                fprintf(stderr, "bad prefetcher %s\n", argv[option]);
+                return EXIT_FAILURE;
             }
         }
-        if(L2CacheHit){ //put evicted block in L1, and move any evicted block from L1 to L2
-            index = computeIndex(address, L1NumSets, blockSize);
-            tag = computeTag(address, L1NumSets, blockSize);
-            for(int i = 0; i < L1Associativity; i ++){
-                //check for first invalid block to put evicted block in
-                if(L1Cache->setArray[index]->blockArray[i]->valid == 0){
-                    L1SpaceAvailable = true;
-                    L1Cache->setArray[index]->blockArray[i]->valid = 1;
-                    L1Cache->setArray[index]->blockArray[i]->tag = tag;
-                    L1Cache->setArray[index]->blockArray[i]->age = age;
-                    L1Cache->setArray[index]->blockArray[i]->address = address;
-                    break;
-                }
+        else if(strcmp(argv[option], "--prefetch-latency") == 0 && option + 1 < argc){
+            prefetchLatency = atoi(argv[++ option]);
+        }
+        else if(strcmp(argv[option], "--threads") == 0 && option + 1 < argc){
+            numThreads = atoi(argv[++ option]);
+        }
+        else if(strcmp(argv[option], "--seed") == 0 && option + 1 < argc){
+            seed = strtoul(argv[++ option], NULL, 10);
+        }
+        else if(strcmp(argv[option], "--stats") == 0 && option + 1 < argc){
+            statsPath = argv[++ option];
+        }
+        else if(strcmp(argv[option], "--stats-window") == 0 && option + 1 < argc){
+            statsWindow = strtoul(argv[++ option], NULL, 10);
+            if(statsWindow == 0){
+                fprintf(stderr, "bad stats window %s\n", argv[option]);
+                return EXIT_FAILURE;
             }
-            //if all blocks are valid then it is a collision, need to evict block to make space, and move evicted block to L2
-            if(!L1SpaceAvailable){
-                int tempIndex = 0;
-                int tempAge = L1Cache->setArray[index]->blockArray[0]->age;
-                for(int i = 1; i < L1Associativity; i ++){
-                    //find index of block with lowest age
-                    if(L1Cache->setArray[index]->blockArray[i]->age < L1Cache->setArray[index]->blockArray[i-1]->age){
-                        if(L1Cache->setArray[index]->blockArray[i]->age < tempAge){
-                            tempAge = L1Cache->setArray[index]->blockArray[i]->age;
-                            tempIndex = i;
-                        }
-                    }
-                    else{
-                        if(L1Cache->setArray[index]->blockArray[i - 1]->age < tempAge){
-                            tempAge = L1Cache->setArray[index]->blockArray[i - 1]->age;
-                            tempIndex = i - 1;
-                        }
-                    }
-                }
-                //replace the block with the lowest age and update age
-                unsigned long tempAddress = L1Cache->setArray[index]->blockArray[tempIndex]->address;
-                L1Cache->setArray[index]->blockArray[tempIndex]->tag = tag;
-                L1Cache->setArray[index]->blockArray[tempIndex]->age = age;
-                L1Cache->setArray[index]->blockArray[tempIndex]->address = address;
-                //move evicted block to L2
-                index = computeIndex(tempAddress, L2NumSets, blockSize);
-                tag = computeTag(tempAddress, L2NumSets, blockSize);
-                for(int i = 0; i < L2Associativity; i ++){
-                    if(L2Cache->setArray[index]->blockArray[i]->valid == 0){
-                        L2SpaceAvailable = true;
-                        L2Cache->setArray[index]->blockArray[i]->valid = 1;
-                        L2Cache->setArray[index]->blockArray[i]->tag = tag;
-                        L2Cache->setArray[index]->blockArray[i]->age = age;
-                        L2Cache->setArray[index]->blockArray[i]->address = tempAddress;
-                        break;
-                    }
-                }
-                if(!L2SpaceAvailable){
-                    tempIndex = 0;
-                    tempAge = L2Cache->setArray[index]->blockArray[0]->age;
-                    for(int i = 1; i < L2Associativity; i ++){
-                        //find index of block with lowest age
-                        if(L2Cache->setArray[index]->blockArray[i]->age < L2Cache->setArray[index]->blockArray[i-1]->age){
-                            if(L2Cache->setArray[index]->blockArray[i]->age < tempAge){
-                                tempAge = L2Cache->setArray[index]->blockArray[i]->age;
-                                tempIndex = i;
-                            }
-                        }
-                        else{
-                            if(L2Cache->setArray[index]->blockArray[i - 1]->age < tempAge){
-                                tempAge = L2Cache->setArray[index]->blockArray[i - 1]->age;
-                                tempIndex = i - 1;
-                            }
-                        }
-                    }
-                    //replace the block with the lowest age and update age
-                    L2Cache->setArray[index]->blockArray[tempIndex]->tag = tag;
-                    L2Cache->setArray[index]->blockArray[tempIndex]->age = age;
-                    L2Cache->setArray[index]->blockArray[tempIndex]->address = tempAddress;
-                }
+        }
+        else if(strcmp(argv[option], "--checkpoint") == 0 && option + 1 < argc){
+            checkpointPath = argv[++ option];
+        }
+        else if(strcmp(argv[option], "--checkpoint-every") == 0 && option + 1 < argc){
+            checkpointEvery = strtoul(argv[++ option], NULL, 10);
+        }
+        else if((strcmp(argv[option], "--resume") == 0 || strcmp(argv[option], "--warm") == 0) && option + 1 < argc){
+            warm = strcmp(argv[option], "--warm") == 0;
+            resumePath = argv[++ option];
+        }
+        else if(strcmp(argv[option], "--records") == 0 && option + 1 < argc){
+            recordLimit = strtoul(argv[++ option], NULL, 10);
+        }
+        else if(strcmp(argv[option], "--sample-sets") == 0 && option + 1 < argc){
+            sampling.setRatio = strtoul(argv[++ option], NULL, 10);
+            if(sampling.setRatio < 2){
+                fprintf(stderr, "bad set sampling ratio %s\n", argv[option]);
+                return EXIT_FAILURE;
             }
-            //update memwrites if applicable
-            if(memAction == 'W'){
-                memWrites ++;
+            sampled = true;
+        }
+        else if(strcmp(argv[option], "--sample-intervals") == 0 && option + 1 < argc){
+            if(!parseIntervalSampling(argv[++ option], &sampling)){
+                fprintf(stderr, "bad sampling intervals %s\n", argv[option]);
+                return EXIT_FAILURE;
             }
+            sampled = true;
         }
-        //if L1 & L2 cache miss
-        if(!L2CacheHit && !L1CacheHit){
-            L2CacheMisses ++;
-            L1SpaceAvailable = false;
-            L2SpaceAvailable = false;
-            index = computeIndex(address, L1NumSets, blockSize);
-            tag = computeTag(address, L1NumSets, blockSize);
-            for(int i = 0; i < L1Associativity; i ++){
-                //check for first invalid block to put new block in
-                if(L1Cache->setArray[index]->blockArray[i]->valid == 0){
-                    L1SpaceAvailable = true;
-                    L1Cache->setArray[index]->blockArray[i]->valid = 1;
-                    L1Cache->setArray[index]->blockArray[i]->tag = tag;
-                    L1Cache->setArray[index]->blockArray[i]->age = age;
-                    L1Cache->setArray[index]->blockArray[i]->address = address;
-                    break;
-                }
+        else{
+            fprintf(stderr, "unknown option %s\n", argv[option]);
+            return EXIT_FAILURE;
+        }
+        option ++;
+    }
+    argv += option - 1;
+    if(statsPath != NULL && sweepPath != NULL){
+        fprintf(stderr, "--stats needs a single configuration\n");
+        return EXIT_FAILURE;
+    }
+    bool checkpointed = checkpointPath != NULL || resumePath != NULL || recordLimit > 0;
+    if(checkpointed && sweepPath != NULL){
+        fprintf(stderr, "checkpoints need a single configuration\n");
+        return EXIT_FAILURE;
+    }
+    //a sample estimates plain counters of one configuration
+    if(sampled && (sweepPath != NULL || statsPath != NULL || checkpointed)){
+        fprintf(stderr, "sampling needs a single configuration without --stats or checkpoints\n");
+        return EXIT_FAILURE;
+    }
+    if(sampling.setRatio > 1 && sampling.period > 0){
+        fprintf(stderr, "set sampling can't be combined with interval sampling\n");
+        return EXIT_FAILURE;
+    }
+    struct Hierarchy **simulators;
+    int numSimulators;
+    char *tracePath;
+    if(sweepPath != NULL){
+        //second --sweep <sweep file> <trace file>
+        numSimulators = readSweepFile(sweepPath, &simulators);
+        tracePath = argv[1];
+        if(numSimulators < 0){
+            printf("error");
+            return EXIT_SUCCESS;
+        }
+    }
+    else if(configPath != NULL){
+        //second --config <hierarchy file> <trace file>
+        simulators = malloc(sizeof(struct Hierarchy *));
+        simulators[0] = readHierarchyFile(configPath);
+        numSimulators = 1;
+        tracePath = argv[1];
+        if(simulators[0] == NULL){
+            free(simulators);
+            printf("error");
+            return EXIT_SUCCESS;
+        }
+    }
+    else{
+        int L1CacheSize = atoi(argv[1]);
+        char* L1AssociativityArg = argv[2];
+        char L1AssociativityString[strlen(L1AssociativityArg)];
+        strncpy(L1AssociativityString, &L1AssociativityArg[6], strlen(L1AssociativityArg));
+        int L1Associativity = atoi(L1AssociativityString);
+        char* L1Policy = argv[3];
+        int blockSize = atoi(argv[4]);
+        int L2CacheSize = atoi(argv[5]);
+        char* L2AssociativityArg = argv[6];
+        char L2AssociativityString[strlen(L2AssociativityArg)];
+        strncpy(L2AssociativityString, &L2AssociativityArg[6], strlen(L2AssociativityArg));
+        int L2Associativity = atoi(L2AssociativityString);
+        char* L2Policy = argv[7];
+        tracePath = argv[8];
+        simulators = malloc(sizeof(struct Hierarchy *));
+        simulators[0] = newSimulator(L1CacheSize, L1Associativity, L1Policy, blockSize, L2CacheSize, L2Associativity, L2Policy);
+        if(simulators[0] == NULL){
+            fprintf(stderr, "can't allocate a %d byte L1 and %d byte L2\n", L1CacheSize, L2CacheSize);
+            free(simulators);
+            return EXIT_FAILURE;
+        }
+        numSimulators = 1;
+    }
+    //the write policy and prefetch options override a hierarchy file
+    for(int i = 0; i < numSimulators; i ++){
+        if(writeBack){
+            simulators[i]->writes.writeBack = true;
+        }
+        if(noWriteAllocate){
+            simulators[i]->writes.writeAllocate = false;
+        }
+        if(prefetch){
+            if(simulators[i]->prefetcher != NULL){
+                freePrefetcher(simulators[i]->prefetcher);
             }
-            //if all blocks are valid then it is a collision
-            if(!L1SpaceAvailable){
-                int tempIndex = 0;
-                int tempAge = L1Cache->setArray[index]->blockArray[0]->age;
-                for(int i = 1; i < L1Associativity; i ++){
-                    //find index of block with lowest age
-                    if(L1Cache->setArray[index]->blockArray[i]->age < L1Cache->setArray[index]->blockArray[i-1]->age){
-                        if(L1Cache->setArray[index]->blockArray[i]->age < tempAge){
-                            tempAge = L1Cache->setArray[index]->blockArray[i]->age;
-                            tempIndex = i;
-                        }
-                    }
-                    else{
-                        if(L1Cache->setArray[index]->blockArray[i - 1]->age < tempAge){
-                            tempAge = L1Cache->setArray[index]->blockArray[i - 1]->age;
-                            tempIndex = i - 1;
-                        }
-                    }
-                }
-                //replace the block with the lowest age and update age
-                unsigned long tempAddress = L1Cache->setArray[index]->blockArray[tempIndex]->address;
-                L1Cache->setArray[index]->blockArray[tempIndex]->tag = tag;
-                L1Cache->setArray[index]->blockArray[tempIndex]->age = age;
-                L1Cache->setArray[index]->blockArray[tempIndex]->address = address;
-                //move evicted block to L2
-                index = computeIndex(tempAddress, L2NumSets, blockSize);
-                tag = computeTag(tempAddress, L2NumSets, blockSize);
-                for(int i = 0; i < L2Associativity; i ++){
-                    if(L2Cache->setArray[index]->blockArray[i]->valid == 0){
-                        L2SpaceAvailable = true;
-                        L2Cache->setArray[index]->blockArray[i]->valid = 1;
-                        L2Cache->setArray[index]->blockArray[i]->tag = tag;
-                        L2Cache->setArray[index]->blockArray[i]->age = age;
-                        L2Cache->setArray[index]->blockArray[i]->address = tempAddress;
-                        break;
-                    }
-                }
-                if(!L2SpaceAvailable){
-                    tempIndex = 0;
-                    tempAge = L2Cache->setArray[index]->blockArray[0]->age;
-                    for(int i = 1; i < L2Associativity; i ++){
-                        //find index of block with lowest age
-                        if(L2Cache->setArray[index]->blockArray[i]->age < L2Cache->setArray[index]->blockArray[i-1]->age){
-                            if(L2Cache->setArray[index]->blockArray[i]->age < tempAge){
-                                tempAge = L2Cache->setArray[index]->blockArray[i]->age;
-                                tempIndex = i;
-                            }
-                        }
-                        else{
-                            if(L2Cache->setArray[index]->blockArray[i - 1]->age < tempAge){
-                                tempAge = L2Cache->setArray[index]->blockArray[i - 1]->age;
-                                tempIndex = i - 1;
-                            }
-                        }
-                    }
-                    //replace the block with the lowest age and update age
-                    L2Cache->setArray[index]->blockArray[tempIndex]->tag = tag;
-                    L2Cache->setArray[index]->blockArray[tempIndex]->age = age;
-                    L2Cache->setArray[index]->blockArray[tempIndex]->address = tempAddress;
-                }
+            prefetchConfig.latency = prefetchLatency;
+            simulators[i]->prefetcher = newPrefetcher(prefetchConfig, simulators[i]->blockSize);
+        }
+        //a different stream per level so random levels don't evict in lockstep
+        for(int level = 0; level < simulators[i]->numLevels; level ++){
+            seedReplacement(&simulators[i]->levels[level].cache->replacement, seed * MAX_LEVELS + level);
+        }
+    }
+    //--resume carries on with the counters of the checkpoint, --warm only with its cache contents
+    int status = EXIT_SUCCESS;
+    struct TracePosition position = {0, 0, 0};
+    if(resumePath != NULL){
+        enum CheckpointResult result = loadCheckpoint(simulators[0], resumePath, !warm, &position);
+        if(result != CHECKPOINT_OK){
+            fprintf(stderr, result == CHECKPOINT_MISMATCH ? "checkpoint %s doesn't match the configuration\n" : "can't read checkpoint %s\n", resumePath);
+            freeHierarchy(simulators[0]);
+            free(simulators);
+            return EXIT_FAILURE;
+        }
+    }
+    struct Sampler *sampler = NULL;
+    if(sampled){
+        //a prefetcher fills sets other than the one it trains on, which set sampling can't follow
+        struct Level *fewest = &simulators[0]->levels[fewestSetsLevel(simulators[0])];
+        if(sampling.setRatio > 1 && simulators[0]->prefetcher != NULL){
+            fprintf(stderr, "set sampling can't be combined with a prefetcher\n");
+        }
+        else{
+            sampler = newSampler(sampling, fewest->numSets, simulators[0]->blockSize, simulators[0], hierarchyCounters);
+            if(sampler == NULL){
+                fprintf(stderr, "set sampling 1 in %lu leaves fewer than two of the %d sets\n", sampling.setRatio, fewest->numSets);
             }
-            if(memAction == 'R'){
-                memReads ++;
+        }
+        if(sampler == NULL){
+            freeHierarchy(simulators[0]);
+            free(simulators);
+            return EXIT_FAILURE;
+        }
+    }
+    struct StatsStream *stats = NULL;
+    if(statsPath != NULL){
+        stats = newStatsStream(statsPath, statsWindow);
+        if(stats == NULL){
+            fprintf(stderr, "can't write %s\n", statsPath);
+            return EXIT_FAILURE;
+        }
+        setHierarchyStats(simulators[0], stats);
+    }
+    struct TraceReader *reader = openTrace(tracePath);
+    if(reader == NULL){
+        status = traceOpenFailure();
+    }
+    else if(sampler != NULL){
+        runSampled(sampler, reader, simulators[0], simulateHierarchy);
+        if(traceReadFailed(reader)){
+            status = EXIT_FAILURE;
+        }
+        else{
+            printSampledResults(sampler, stdout);
+        }
+        if(verbose){
+            printTraceStats(reader, stderr);
+        }
+        closeTrace(reader);
+    }
+    else{
+        SimulateFunction simulate = stats != NULL ? windowedHierarchy : simulateHierarchy;
+        struct RecentRecords recent;
+        if(checkpointed && resumePath != NULL && !seekCheckpoint(reader, &position, &recent)){
+            fprintf(stderr, "checkpoint %s wasn't taken on this trace, or the trace ends before it\n", resumePath);
+            status = EXIT_FAILURE;
+        }
+        else if(checkpointed){
+            if(!runCheckpointed(reader, simulators[0], simulate, &recent, position.records, recordLimit, checkpointPath, checkpointEvery)){
+                fprintf(stderr, "can't write checkpoint %s\n", checkpointPath);
+                status = EXIT_FAILURE;
             }
-            else{
-                memReads ++;
-                memWrites ++;
+        }
+        else{
+            runSweep(reader, (void **)simulators, numSimulators, simulate, numThreads);
+        }
+        if(status == EXIT_SUCCESS && traceReadFailed(reader)){
+            status = EXIT_FAILURE;
+        }
+        if(status != EXIT_SUCCESS){
+            //the trace or a checkpoint failed, results would look valid without them
+        }
+        else if(sweepPath != NULL){
+            for(int i = 0; i < numSimulators; i ++){
+                printSweepRow(simulators[i]);
             }
         }
-        age ++;
+        else{
+            printHierarchyResults(simulators[0], stdout);
+        }
+        if(verbose){
+            printTraceStats(reader, stderr);
+        }
+        closeTrace(reader);
     }
-    printf("memread:%d\nmemwrite:%d\nl1cachehit:%d\nl1cachemiss:%d\nl2cachehit:%d\nl2cachemiss:%d\n", memReads, memWrites, L1CacheHits, L1CacheMisses, L2CacheHits, L2CacheMisses);
-    fclose(file);
-}
-
-int main(int argc, char* argv[argc + 1]){
-    int L1CacheSize = atoi(argv[1]);
-    char* L1AssociativityArg = argv[2];
-    char L1AssociativityString[strlen(L1AssociativityArg)];
-    strncpy(L1AssociativityString, &L1AssociativityArg[6], strlen(L1AssociativityArg));
-    int L1Associativity = atoi(L1AssociativityString);
-    char* L1Policy = argv[3];
-    int blockSize = atoi(argv[4]);
-    int L1NumSets = L1CacheSize / L1Associativity / blockSize;
-    int L2CacheSize = atoi(argv[5]);
-    char* L2AssociativityArg = argv[6];
-    char L2AssociativityString[strlen(L2AssociativityArg)];
-    strncpy(L2AssociativityString, &L2AssociativityArg[6], strlen(L2AssociativityArg));
-    int L2Associativity = atoi(L2AssociativityString);
-    char* L2Policy = argv[7];
-    int L2NumSets = L2CacheSize / L2Associativity / blockSize;
-    FILE *file = fopen(argv[8], "r");
-    if(file == NULL){
-        printf("error");
+    if(stats != NULL && !closeStatsStream(stats, simulators[0], hierarchyTotals)){
+        fprintf(stderr, "can't write %s\n", statsPath);
     }
-    else{
-        struct Cache *L1Cache = newCache(L1NumSets, L1Associativity, blockSize);
-        struct Cache *L2Cache = newCache(L2NumSets, L2Associativity, blockSize);
-        cacheSimulator(file, L1Cache, L2Cache, L1Associativity, L2Associativity, blockSize, L1NumSets, L2NumSets, L1Policy, L2Policy);
-        freeCache(L1Cache);
-        freeCache(L2Cache);
+    if(sampler != NULL){
+        freeSampler(sampler);
     }
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    for(int i = 0; i < numSimulators; i ++){
+        freeHierarchy(simulators[i]);
+    }
+    free(simulators);
+    return status;
+}